@@ -10,17 +10,153 @@
 // - Split: Copy a of a char array up to a delimiter + null terminator 
 // - Cpy: Copy a char array + null terminator to a buffer
 // - Cmp: Compare two char arrays
+// - Ncmp: Compare a char array against a key of known length
+// - Scan: Find the first of two chars in a char array
+// - To<Type>: Parse a number from a char array of known length
+// - FromUint: Format a number into a char array
+
+
+
+// ** // *** SCANNING *** // ** //
+// The scalar scans are the reference. The SWAR (word at a time) and SIMD (SSE2/NEON)
+// scans return the same index and are picked at compile time when available.
+// Define UC_SCALAR to use only the scalar scans, or UC_NO_SIMD to stop at SWAR.
+
+#if !defined(UC_SCALAR) && (defined(__GNUC__) || defined(__clang__))
+#define UC_SWAR 1
+typedef unsigned long __attribute__((__may_alias__)) uCword;
+#define UC_ONES ((uCword)-1 / 0xFF) // 0x0101...01
+#define UC_HIGHS (UC_ONES * 0x80) // 0x8080...80
+#define UC_HAS_ZERO(v) (((v) - UC_ONES) & ~(v) & UC_HIGHS) // Non zero if any byte of v is 0
+#if !defined(UC_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define UC_SSE2 1
+#elif !defined(UC_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define UC_NEON 1
+#endif
+#endif
+
+int uCscanScalar(const char *buf, int start, int end, char a, char b){
+    //@brief: find the first a or b in buf[start, end)
+    //@return: index of the first match, end if not found
+    int i = start;
+    while(i < end && buf[i] != a && buf[i] != b){
+        i++;
+    }
+    return i;
+}
+
+const char *uCscanStrScalar(const char *str, char a){
+    //@brief: find the first a or null terminator in a string
+    //@return: pointer to the first match
+    while(*str != a && *str != '\0'){
+        str++;
+    }
+    return str;
+}
+
+#ifdef UC_SWAR
+int uCscanSwar(const char *buf, int start, int end, char a, char b){
+    //@brief: find the first a or b in buf[start, end) a word at a time
+    //@return: index of the first match, end if not found
+    //@note: Only bytes inside [start, end) are read
+    uCword pa = UC_ONES * (unsigned char)a;
+    uCword pb = UC_ONES * (unsigned char)b;
+    int i = start;
+    while(i + (int)sizeof(uCword) <= end){
+        uCword w;
+        __builtin_memcpy(&w, &buf[i], sizeof(w));
+        if(UC_HAS_ZERO(w ^ pa) | UC_HAS_ZERO(w ^ pb)){
+            break; // The match is in this word
+        }
+        i += sizeof(uCword);
+    }
+    return uCscanScalar(buf, i, end, a, b);
+}
+
+__attribute__((no_sanitize_address))
+const char *uCscanStrSwar(const char *str, char a){
+    //@brief: find the first a or null terminator in a string a word at a time
+    //@return: pointer to the first match
+    //@note: Aligned words may be read past the terminator but never across a page
+    while((__UINTPTR_TYPE__)str % sizeof(uCword) != 0){
+        if(*str == a || *str == '\0') return str;
+        str++;
+    }
+    uCword pa = UC_ONES * (unsigned char)a;
+    for(;;){
+        uCword w = *(const uCword *)str;
+        if(UC_HAS_ZERO(w) | UC_HAS_ZERO(w ^ pa)){
+            break; // The match is in this word
+        }
+        str += sizeof(uCword);
+    }
+    return uCscanStrScalar(str, a);
+}
+#endif
+
+#if defined(UC_SSE2) || defined(UC_NEON)
+#define UC_SIMD 1
+int uCscanSimd(const char *buf, int start, int end, char a, char b){
+    //@brief: find the first a or b in buf[start, end) 16 bytes at a time
+    //@return: index of the first match, end if not found
+    //@note: Only bytes inside [start, end) are read
+    int i = start;
+#ifdef UC_SSE2
+    __m128i va = _mm_set1_epi8(a);
+    __m128i vb = _mm_set1_epi8(b);
+    while(i + 16 <= end){
+        __m128i v = _mm_loadu_si128((const __m128i *)&buf[i]);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if(mask != 0){
+            return i + __builtin_ctz(mask);
+        }
+        i += 16;
+    }
+#else
+    uint8x16_t va = vdupq_n_u8((unsigned char)a);
+    uint8x16_t vb = vdupq_n_u8((unsigned char)b);
+    while(i + 16 <= end){
+        uint8x16_t v = vld1q_u8((const unsigned char *)&buf[i]);
+        if(vmaxvq_u8(vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb))) != 0){
+            break; // The match is in this block
+        }
+        i += 16;
+    }
+#endif
+    return uCscanSwar(buf, i, end, a, b);
+}
+#endif
+
+int uCscan(const char *buf, int start, int end, char a, char b){
+    //@brief: find the first a or b in buf[start, end) with the fastest available scan
+    //@return: index of the first match, end if not found
+#if defined(UC_SIMD)
+    return uCscanSimd(buf, start, end, a, b);
+#elif defined(UC_SWAR)
+    return uCscanSwar(buf, start, end, a, b);
+#else
+    return uCscanScalar(buf, start, end, a, b);
+#endif
+}
+
+const char *uCscanStr(const char *str, char a){
+    //@brief: find the first a or null terminator in a string with the fastest available scan
+    //@return: pointer to the first match
+#if defined(UC_SWAR)
+    return uCscanStrSwar(str, a);
+#else
+    return uCscanStrScalar(str, a);
+#endif
+}
 
 
 
 unsigned int uCsize(char *str){
     //@brief: Return the size of a string 
     //@Note:  Includes the null terminator
-    int len = 0;
-    while(*str++ != '\0'){
-        len++;
-    }
-    return len + 1;
+    return uCscanStr(str, '\0') - str + 1;
 }
 
 void uCcpy(char *p,char const *q){
@@ -48,13 +184,9 @@ int uStrcmp(char *str1, char *str2){
 int uCSplit(char *buf, char *src, char delim, int start){
     //@brief: copy a string to a buffer until a delimiter is found
     //@return: the index of the next character after the delimiter
-    int j = 0;
-    for(int i = start; src[i] != '\0';i++){
-        if (src[i] == delim){
-            break;
-        }
-        buf[j] = src[i];
-        j++;
+    int j = uCscanStr(&src[start], delim) - &src[start];
+    for(int i = 0; i < j; i++){
+        buf[i] = src[start + i];
     }
     buf[j] = '\0';
     return j+1;
@@ -65,12 +197,11 @@ int uCTrunk(char *buf, const char *src, int startIdx, int endIdx){
     //@return: number of characters copied excluding '\0'
     //@note: Null terminatior is inserted
     //@note: buffer overflow is not checked
+    //@note: src must be readable over [startIdx, endIdx)
     
+    int end = uCscan(src, startIdx, endIdx, '\0', '\0'); // Stop at the null terminator
     int j = 0; // buffer index
-    for(int i = startIdx; i < endIdx;i++){
-        if (src[i] == '\0'){
-            break;
-        }
+    for(int i = startIdx; i < end;i++){
         buf[j] = src[i];
         j++;
     }
@@ -80,16 +211,157 @@ int uCTrunk(char *buf, const char *src, int startIdx, int endIdx){
 
 
 
+int uCncmp(const char *str, const char *key, int len){
+    //@brief: compare a string against the first len chars of a key
+    //@return: 0 if str is exactly those len chars, 1 if not equal
+    //@note: Unlike uStrcmp a prefix does not match
+    for(int i = 0; i < len; i++){
+        if(str[i] == '\0' || str[i] != key[i]){
+            return 1;
+        }
+    }
+    return str[len] != '\0';
+}
+
+
+
+// ** // *** NUMBER PARSING *** // ** //
+// Parse a number from exactly len chars, no null terminator is needed.
+// All return 0 if successful, -1 if a char is invalid, len is 0 or the value overflows.
+
+int uCtoUint(const char *buf, int len, int base, unsigned long *out){
+    //@brief: parse an unsigned decimal (base 10) or hex (base 16) number
+    //@note: Hex digits may be upper or lower case, no 0x prefix
+    if(len <= 0) return -1;
+    unsigned long value = 0;
+    for(int i = 0; i < len; i++){
+        char c = buf[i];
+        int digit;
+        if(c >= '0' && c <= '9') digit = c - '0';
+        else if(base == 16 && c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if(base == 16 && c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return -1; // Invalid char
+        if(value > ((unsigned long)-1 - digit) / base) return -1; // Overflow
+        value = value * base + digit;
+    }
+    *out = value;
+    return 0;
+}
+
+int uCtoInt(const char *buf, int len, long *out){
+    //@brief: parse a signed decimal number with an optional '+' or '-'
+    int neg = (len > 0 && buf[0] == '-');
+    int sign = (len > 0 && (buf[0] == '-' || buf[0] == '+'));
+    unsigned long mag;
+    if(uCtoUint(buf + sign, len - sign, 10, &mag) != 0) return -1;
+    unsigned long limit = (unsigned long)((~0UL) >> 1) + neg; // LONG_MAX, or LONG_MAX + 1 if negative
+    if(mag > limit) return -1; // Overflow
+    *out = neg ? (long)(0 - mag) : (long)mag;
+    return 0;
+}
+
+int uCtoFixed(const char *buf, int len, int scale, long *out){
+    //@brief: parse a decimal number as an integer scaled by 10^scale
+    //@note: "1.5" with scale 2 gives 150, more than scale fraction digits is an error
+    int dot = uCscanScalar(buf, 0, len, '.', '.');
+    int frac = (dot < len) ? len - dot - 1 : 0; // Number of fraction digits
+    if(frac > scale) return -1; // Too precise for the scale
+    long whole = 0;
+    unsigned long part = 0;
+    int neg = (len > 0 && buf[0] == '-');
+    if(dot == neg && frac > 0){
+        whole = 0; // No integer digits, e.g. ".5" or "-.5"
+    }
+    else if(uCtoInt(buf, dot, &whole) != 0){
+        return -1;
+    }
+    if(frac > 0 && uCtoUint(&buf[dot + 1], frac, 10, &part) != 0) return -1;
+    for(int i = frac; i < scale; i++){
+        part *= 10; // Pad the fraction to the scale
+    }
+    long mult = 1;
+    for(int i = 0; i < scale; i++){
+        mult *= 10;
+    }
+    *out = neg ? whole * mult - (long)part : whole * mult + (long)part;
+    return 0;
+}
+
+int uCtoFloat(const char *buf, int len, float *out){
+    //@brief: parse a decimal number with an optional fraction and exponent, e.g. "-1.25e3"
+    int i = 0;
+    int neg = 0;
+    if(i < len && (buf[i] == '-' || buf[i] == '+')){
+        neg = (buf[i] == '-');
+        i++;
+    }
+    double value = 0;
+    int digits = 0;
+    for(; i < len && buf[i] >= '0' && buf[i] <= '9'; i++, digits++){
+        value = value * 10 + (buf[i] - '0');
+    }
+    if(i < len && buf[i] == '.'){
+        double place = 0.1;
+        for(i++; i < len && buf[i] >= '0' && buf[i] <= '9'; i++, digits++){
+            value += (buf[i] - '0') * place;
+            place *= 0.1;
+        }
+    }
+    if(digits == 0) return -1; // No digits
+    if(i < len && (buf[i] == 'e' || buf[i] == 'E')){
+        long exp;
+        if(uCtoInt(&buf[i + 1], len - i - 1, &exp) != 0 || exp > 38 || exp < -45) return -1;
+        for(; exp > 0; exp--) value *= 10;
+        for(; exp < 0; exp++) value /= 10;
+        i = len;
+    }
+    if(i != len) return -1; // Invalid char
+    *out = (float)(neg ? -value : value);
+    return 0;
+}
+
+
+
+int uCfromUint(char *buf, unsigned long value){
+    //@brief: format an unsigned number as decimal chars + null terminator
+    //@return: number of chars written excluding '\0'
+    //@note: buffer overflow is not checked, 21 chars always fit
+    char digits[20];
+    int n = 0;
+    do{
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    }while(value != 0);
+    for(int i = 0; i < n; i++){
+        buf[i] = digits[n - 1 - i];
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+
+
 // Hash Function for the table
-unsigned int hash(char *key, int tableSize){
-    int m = 31;
-    unsigned int len = uCsize(key); 
+unsigned int hashKey(const char *key, int len){
+    //@brief: hash the first len chars of a key
+    //@return: full 32 bit hash value
+    unsigned int m = 31;
     unsigned int hashValue = 0;
     for(int i = 0; i < len; i++){
-        hashValue = (hashValue * m + key[i]);
-
+        hashValue = (hashValue * m + (unsigned char)key[i]);
     }
-    return hashValue % tableSize;
+    return hashValue;
+}
+
+unsigned int hashLen(const char *key, int len, int tableSize){
+    //@brief: hash the first len chars of a key
+    //@return: table index in [0, tableSize)
+    return hashKey(key, len) % tableSize;
+}
+
+unsigned int hash(char *key, int tableSize){
+    //@brief: hash a null terminated key
+    return hashLen(key, uCsize(key) - 1, tableSize);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,177 @@
+#ifndef __LOOKUPTABLE_H__
+#define __LOOKUPTABLE_H__
+
+#include "helpers.h"
+/* Flat open addressing hash table of short string keys and values, e.g. device config.
+   Entries live in one caller supplied array with keys and values inline, so a lookup
+   touches consecutive memory only. Collisions are resolved by linear probing, removal
+   leaves a tombstone, and tombstones are purged in place when they crowd the table. */
+
+// Lookup Table Definitions, re-define before the include to resize
+#ifndef LT_KEY_SIZE
+#define LT_KEY_SIZE 10 // Max length of a key including '\0'
+#endif
+#ifndef LT_VALUE_SIZE
+#define LT_VALUE_SIZE 10 // Max length of a value including '\0'
+#endif
+
+#define LT_EMPTY 0 // Never used, ends a probe
+#define LT_USED 1
+#define LT_DELETED 2 // Tombstone, a probe continues past it
+#define LT_MOVING 3 // Only during a purge: entry not yet at its final slot
+
+
+
+typedef struct LTEntry{
+    unsigned char state;
+    unsigned char tag; // Hash bits compared before the key
+    char key[LT_KEY_SIZE];
+    char value[LT_VALUE_SIZE];
+} LTEntry; // A key and its value, stored inline
+
+typedef struct LookupTable{
+    LTEntry *entries; // Caller supplied, capacity entries
+    int capacity;
+    int count; // Used entries
+    int tombstones; // Deleted entries still in probe paths
+} LookupTable; // Open addressing table with inline keys and values
+
+
+// *** // Internal functions // *** //
+static unsigned char ltTag(unsigned int h){
+    return (unsigned char)(h >> 24);
+}
+
+static int ltMatch(LTEntry *entry, unsigned char tag, const char *key, int len){
+    return entry->tag == tag && uCncmp(entry->key, key, len) == 0;
+}
+
+static int ltFind(LookupTable *table, const char *key, int len){
+    // @brief Find the slot of a key
+    // @return: Slot index or -1 if the key is not in the table
+    // @note: At least one slot is always empty, so the probe ends
+    unsigned int h = hashKey(key, len);
+    unsigned char tag = ltTag(h);
+    int slot = h % table->capacity;
+    while(table->entries[slot].state != LT_EMPTY){
+        if(table->entries[slot].state == LT_USED && ltMatch(&table->entries[slot], tag, key, len)){
+            return slot;
+        }
+        slot = (slot + 1) % table->capacity;
+    }
+    return -1;
+}
+
+static void ltPurge(LookupTable *table){
+    // @brief Drop every tombstone and re-place the entries, in place without extra memory
+    // @desc: An entry goes to the first empty or unplaced slot from its home. Slots it skips
+    // @desc: hold placed entries, which never move again, so every probe stays unbroken.
+    LTEntry *entries = table->entries;
+    for(int i = 0; i < table->capacity; i++){
+        entries[i].state = (entries[i].state == LT_USED) ? LT_MOVING : LT_EMPTY;
+    }
+    for(int i = 0; i < table->capacity; i++){
+        while(entries[i].state == LT_MOVING){
+            int slot = hash(entries[i].key, table->capacity);
+            while(entries[slot].state == LT_USED){
+                slot = (slot + 1) % table->capacity;
+            }
+            if(slot == i){
+                entries[i].state = LT_USED; // Already at its final slot
+            }
+            else if(entries[slot].state == LT_EMPTY){
+                entries[slot] = entries[i];
+                entries[slot].state = LT_USED;
+                entries[i].state = LT_EMPTY;
+            }
+            else{
+                LTEntry moving = entries[slot]; // Swap with the unplaced entry and place that one next
+                entries[slot] = entries[i];
+                entries[slot].state = LT_USED;
+                entries[i] = moving;
+            }
+        }
+    }
+    table->tombstones = 0;
+}
+
+
+// *** // **** User Exposed Functions **** // *** //
+void initLookupTable(LookupTable *table, LTEntry *entries, int capacity){
+    // @brief Initialize an empty table over capacity caller supplied entries
+    // @note: One entry always stays empty, so the table holds capacity - 1 keys
+    table->entries = entries;
+    table->capacity = capacity;
+    table->count = 0;
+    table->tombstones = 0;
+    for(int i = 0; i < capacity; i++){
+        entries[i].state = LT_EMPTY;
+    }
+}
+
+char *lookupGetLen(LookupTable *table, const char *key, int len){
+    // @brief Get the value of the first len chars of key, e.g. an argument slice
+    // @return: Pointer to the value or 0 if the key does not exist
+    int slot = ltFind(table, key, len);
+    return (slot < 0) ? 0 : table->entries[slot].value;
+}
+
+char *lookupGet(LookupTable *table, char *key){
+    // @brief Get the value of a null terminated key
+    // @return: Pointer to the value or 0 if the key does not exist
+    return lookupGetLen(table, key, uCsize(key) - 1);
+}
+
+int lookupSet(LookupTable *table, char *key, char *value){
+    // @brief Insert a key or update its value
+    // @return: 0 if successful, -1 if the key or value is too long or the table is full
+    int keyLen = uCsize(key) - 1;
+    if(keyLen + 1 > LT_KEY_SIZE || uCsize(value) > LT_VALUE_SIZE) return -1; // Too long
+    unsigned int h = hashKey(key, keyLen);
+    unsigned char tag = ltTag(h);
+    int slot = h % table->capacity;
+    int free = -1; // First tombstone on the probe path
+    while(table->entries[slot].state != LT_EMPTY){
+        LTEntry *entry = &table->entries[slot];
+        if(entry->state == LT_USED && ltMatch(entry, tag, key, keyLen)){
+            uCcpy(entry->value, value); // Update in place
+            return 0;
+        }
+        if(entry->state == LT_DELETED && free < 0){
+            free = slot;
+        }
+        slot = (slot + 1) % table->capacity;
+    }
+    if(free < 0){
+        if(table->count + 1 >= table->capacity) return -1; // Table is full, keep one slot empty
+        if(table->count + table->tombstones + 1 >= table->capacity || table->tombstones > table->capacity / 4){
+            ltPurge(table); // Tombstones crowd the table, purge them and probe again
+            return lookupSet(table, key, value);
+        }
+        free = slot;
+    }
+    else{
+        table->tombstones--;
+    }
+    LTEntry *entry = &table->entries[free];
+    entry->state = LT_USED;
+    entry->tag = tag;
+    uCcpy(entry->key, key);
+    uCcpy(entry->value, value);
+    table->count++;
+    return 0;
+}
+
+int lookupRemove(LookupTable *table, char *key){
+    // @brief Remove a key, its slot becomes a tombstone
+    // @return: 0 if successful, -1 if the key does not exist
+    int slot = ltFind(table, key, uCsize(key) - 1);
+    if(slot < 0) return -1;
+    table->entries[slot].state = LT_DELETED;
+    table->count--;
+    table->tombstones++;
+    return 0;
+}
+
+
+#endif
@@ -3,275 +3,1407 @@
 
 
 // *** // Includes // *** //
+#include <stdint.h> // uintptr_t
 #include "../include/helpers.h"
 
 
 // *** // Static Array Allocation // *** //
-const int MAX_CMD_SIZE = 28;
-const int MAX_ARGS = 5;
-const int MAX_SERVICES = 10;
-const int MAX_INTERFACES = 5;
-const int MAX_RESPONSE_SIZE = 10;
-const int MAX_ID_SIZE = 5;
-const int TARGET_ARG_LEN = 3; 
+// Define any of these before including the header to resize every buffer and struct
+#ifndef MAX_CMD_SIZE
+#define MAX_CMD_SIZE 28 // Longest message any protocol accepts, caps Protocol.maxCmdLen
+#endif
+#ifndef MAX_ARGS
+#define MAX_ARGS 5 // Most arguments a Protocol can declare
+#endif
+#ifndef MAX_ID_SIZE
+#define MAX_ID_SIZE 5 // Longest id including '\0'
+#endif
+#ifndef TARGET_ARG_LEN
+#define TARGET_ARG_LEN 3 // Chars of the target interface id at the start of every message
+#endif
+
+#if MAX_ID_SIZE > 5 || TARGET_ARG_LEN > MAX_ID_SIZE - 1
+#error "Ids are packed into 32 bits: MAX_ID_SIZE is at most 5 and TARGET_ARG_LEN below it"
+#endif
+#if MAX_ARGS > 255
+#error "MAX_ARGS must fit an argument index byte"
+#endif
+
+// *** // Arena Allocation // *** //
+// Interface and service tables are carved from a caller supplied RPCArena, sized to
+// the counts passed to initRPC and createInterface. Use RPC_TABLE_BYTES to size it.
+#define RPC_ARENA_ALIGN sizeof(void *)
+#define RPC_MAX_ENTRIES 255 // Hash slots store index + 1 in a byte
+#define RPC_TABLE_SLOTS(n) (2 * (n) + 1) // Hash slots for n entries, keeps probes short
+#define RPC_TABLE_BYTES(n) ((n) * sizeof(void *) + RPC_TABLE_SLOTS(n) + 2 * RPC_ARENA_ALIGN) // Worst case with padding
+
+// *** // Metrics // *** //
+// Define MICRORPC_METRICS to count commands, rejections and service latency.
+// Define RPC_NOW() to a cycle counter or ns clock to fill the latency histograms,
+// and MICRORPC_METRICS_ATOMIC when services run on several threads.
+#ifdef MICRORPC_METRICS
+#if defined(MICRORPC_METRICS_ATOMIC) && defined(__GNUC__)
+#define RPC_STAT_ADD(x, n) __atomic_fetch_add(&(x), (n), __ATOMIC_RELAXED)
+#else
+#define RPC_STAT_ADD(x, n) ((x) += (n))
+#endif
+#define RPC_HIST_BUCKETS 32 // Bucket i counts latencies in [2^(i-1), 2^i) ticks
+#endif
+
+// *** // Response Cache // *** //
+// Define MICRORPC_CACHE to let execCommand serve idempotent services from a small
+// direct mapped cache of responses, keyed on the parsed arguments. Cached responses
+// expire after Service.ttl ticks of RPC_NOW() and are dropped when the owning
+// interface changes: any non idempotent service of it runs or completes deferred,
+// or touchInterface.
+#ifdef MICRORPC_CACHE
+#ifndef RPC_CACHE_KEY_SIZE
+#define RPC_CACHE_KEY_SIZE 32 // Bytes of the argument key, commands with longer arguments are not cached
+#endif
+#ifndef RPC_CACHE_RESPONSE_SIZE
+#define RPC_CACHE_RESPONSE_SIZE 32 // Longest cached response
+#endif
+#endif
+
+#if defined(MICRORPC_METRICS) || defined(MICRORPC_CACHE) || defined(MICRORPC_SCHEDULER)
+#ifndef RPC_NOW
+#define RPC_NOW() 0UL // Without a clock latencies read 0 and cached responses never expire
+#endif
+#endif
+
+// *** // Deferred Services // *** //
+// A service that waits on a peripheral or I/O returns RPC_PENDING instead of blocking.
+// Define MICRORPC_ASYNC to let execCommand park such commands in gateway handles:
+// pollDeferred steps them and delivers each result and response once it completes.
+#define RPC_PENDING (-0x7FFF) // Service return value: the command completes later
+#ifdef MICRORPC_ASYNC
+#ifndef RPC_DEFER_TX_SIZE
+#define RPC_DEFER_TX_SIZE 64 // Response buffer of a deferred command
+#endif
+#endif
+
+// *** // Journal // *** //
+// Define MICRORPC_JOURNAL to hand every incoming message to a gateway hook,
+// see microRPCJournal.h for a file writer and a replay tool.
+
+// *** // Multicast // *** //
+// Define MICRORPC_MULTICAST to address many interfaces with one message. A target holding
+// RPC_WILDCARD matches every interface id equal at the other positions, "***" all of them,
+// and a target naming a gateway group matches its members. The message is parsed once with
+// the protocol of the first match; execCommand then runs the service on every matching
+// interface of that protocol offering it and aggregates one record per member.
+#ifdef MICRORPC_MULTICAST
+#ifndef RPC_WILDCARD
+#define RPC_WILDCARD '*' // Matches any char of an interface id
+#endif
+#ifndef RPC_CAST_SEP
+#define RPC_CAST_SEP ';' // Ends each member's record in a multicast response
+#endif
+#ifndef RPC_MAX_GROUPS
+#define RPC_MAX_GROUPS 8 // Groups per gateway
+#endif
+#if RPC_MAX_GROUPS > 8
+#error "RPC_MAX_GROUPS must fit the Interface.groups byte"
+#endif
+#endif
+
+// *** // Argument Indices // *** //
+#define TARGET_IDX 0 // Target interface id
+#define SERVICE_IDX 1 // Target service id
 
 
 // *** // Data Structures // *** //
+#if MAX_CMD_SIZE < 256
+typedef uint8_t rpcLen; // Argument and message lengths, sized by MAX_CMD_SIZE
+#else
+typedef uint16_t rpcLen;
+#endif
+typedef uint32_t RPCId; // Id of up to MAX_ID_SIZE - 1 chars packed into one word, 0 if none
+
+typedef struct RPCArena{
+    unsigned char *buf;
+    int size;
+    int used;
+}RPCArena; // Caller supplied memory for registration tables, never freed
+
 typedef struct Message{
     char *buf; 
     int len; // excluding null character
 }Message; // A message buffer and its length
 
+typedef struct RingView{
+    Message first; // Bytes up to the end of the ring
+    Message second; // Bytes wrapped to the start of the ring, len 0 if none
+}RingView; // A message in a circular buffer, two segments read in order
+
+typedef enum ProtoMode{
+    PROTO_TEXT = 0, // Delimiter separated text: TRGT,SRVC,...
+    PROTO_FIXED, // Binary, each argument is maxSize bytes at a fixed offset
+    PROTO_TLV // Binary, TRGT then |type|len|value| records, type is the argument index
+}ProtoMode; // Wire format of a protocol
+
+typedef enum ArgType{
+    ARG_STR = 0, // String view of the argument, read from Command.args
+    ARG_INT, // Signed decimal, little endian two's complement in binary modes
+    ARG_UINT, // Unsigned decimal, little endian in binary modes
+    ARG_HEX, // Unsigned hex digits, little endian in binary modes
+    ARG_FIXED, // Decimal scaled by 10^scale, e.g. "1.25" -> 125, little endian in binary modes
+    ARG_FLOAT // Decimal with fraction and exponent, 4 byte IEEE 754 in binary modes
+}ArgType; // How an argument is decoded into its ArgValue
+
+#ifdef MICRORPC_MULTICAST
+typedef enum CastMode{
+    CAST_NONE = 0, // Single target interface
+    CAST_PATTERN, // Target with RPC_WILDCARD chars
+    CAST_GROUP // Target naming a gateway group
+}CastMode; // How a command's target selects interfaces
+#endif
+
+typedef union ArgValue{
+    long i; // ARG_INT, ARG_FIXED
+    unsigned long u; // ARG_UINT, ARG_HEX
+    float f; // ARG_FLOAT
+}ArgValue; // A decoded argument, ARG_STR has none: Command.args holds the view
+
 typedef struct CmdArg{
+    RPCId key; // Packed id, set by createInterface
     char id[MAX_ID_SIZE]; 
-    Message str;
-    int maxSize; // Max len including null character
+    uint8_t type; // ArgType, ARG_STR if not set
+    int8_t scale; // Decimal places of an ARG_FIXED argument
+    rpcLen maxSize; // Max len including null character, field width in bytes for PROTO_FIXED
 }CmdArg; // Defines the format of an Argument in a command
 
+typedef struct Command Command;
+typedef struct Response Response;
+typedef struct Deferred Deferred;
+typedef struct Gateway Gateway;
+
 typedef struct Protocol{
     // @brief Defines the protocol for the TASK interface
     // @REQ: |TargetInterface|Service|...
-    int numArgs; 
+    // @note: In every mode the message starts with the TARGET_ARG_LEN byte interface id
+    CmdArg *cmdFormat; // numArgs entries, at most MAX_ARGS
+    int (*parse)(Command *cmd, Message *msgCmd); // Specialized text parser from RPC_PROTOCOL, 0 for the generic one
+    rpcLen maxCmdLen; // excluding '\0', at most MAX_CMD_SIZE takes effect
+    rpcLen maxArgLen; // excluding '\0'
+    uint8_t numArgs; 
+    uint8_t mode; // ProtoMode, PROTO_TEXT if not set
+    uint8_t seqIdx; // Argument carrying a correlation id echoed at the start of each response, 0 if none
+#ifdef MICRORPC_SCHEDULER
+    uint8_t priorityIdx; // ARG_INT argument overriding Service.priority, 0 if none
+    uint8_t deadlineIdx; // ARG_INT or ARG_UINT argument overriding Service.deadline, 0 if none
+#endif
     char delim;
-    int maxCmdLen; // excluding '\0'
-    int maxArgLen; // excluding '\0'
-    CmdArg cmdFormat[MAX_ARGS];
 }Protocol; // Defines the protocol format for a given interface
 
-typedef struct Command{
-    Protocol *proto; 
-    int valid; 
-}Command; // A command that can be executed by an RPC Service
+typedef struct Interface Interface;
+typedef struct Service Service;
+
+typedef enum RejectReason{
+    REJECT_NONE = 0,
+    REJECT_TARGET, // Target interface does not exist
+    REJECT_LENGTH, // Message is longer than maxCmdLen or the parser buffer
+    REJECT_ARGS, // Arguments do not match the protocol
+    REJECT_SERVICE, // Service does not exist
+    NUM_REJECT
+}RejectReason; // Why a message was not turned into a valid command
+
+#ifdef MICRORPC_METRICS
+typedef struct ServiceStats{
+    unsigned long calls;
+    unsigned long totalTicks; // Sum of service latencies
+    unsigned long maxTicks;
+    unsigned long hist[RPC_HIST_BUCKETS]; // Log2 latency histogram
+}ServiceStats; // Per service call counts and latency
+
+typedef struct InterfaceStats{
+    unsigned long commands; // Valid commands parsed
+    unsigned long bytes; // Message bytes of the valid commands
+}InterfaceStats; // Per interface throughput
+
+typedef struct GatewayStats{
+    unsigned long accepted; // Valid commands parsed
+    unsigned long rejects[NUM_REJECT]; // Rejected messages by reason
+}GatewayStats; // Parse results of a gateway
+#endif
+
+struct Command{
+    Protocol *proto; // Read only, shared by all commands for the interface
+    Interface *interface; // Target interface, resolved by updateCommand
+    Service *service; // Target service, resolved by updateCommand
+    Message args[MAX_ARGS]; // Argument slices into the message, zero copy
+    ArgValue argv[MAX_ARGS]; // Arguments decoded by their CmdArg type, 0 if missing or empty
+    uint8_t valid; 
+    uint8_t reject; // RejectReason: why the last message was rejected, REJECT_NONE if valid
+#ifdef MICRORPC_MULTICAST
+    uint8_t cast; // CastMode, execCommand and invokeService fan out unless CAST_NONE
+    RPCId castKey; // CAST_PATTERN: target chars an interface id must hold
+    RPCId castMask; // CAST_PATTERN: bytes of the id compared, CAST_GROUP: the group bit
+    Gateway *castGateway; // Gateway whose interfaces the multicast target selects
+#endif
+#ifdef MICRORPC_ASYNC
+    int (*poll)(Deferred *deferred, Response *response, void *state); // Set by deferService
+    void *pollState;
+    Deferred *deferred; // Handle of the command if execCommand deferred it, else 0
+#endif
+}; // A command that can be executed by an RPC Service
+
+struct Response{
+    char *buf; // Caller supplied buffer, e.g. the transport's transmit buffer
+    int size; // Capacity of buf including the null terminator
+    int len; // Bytes written, excluding the null terminator
+    int overflow; // Set if a write did not fit
+}; // Bounded sink a service writes its response into
 
 // *** // Service Functions // *** //
-typedef int (*rpcFunc)(Command *cmd,char *response, void *data); 
+typedef int (*rpcFunc)(Command *cmd,Response *response, void *data); 
 
-typedef struct Service{
+struct Service{
+    RPCId key; // Packed id, set by registerService
     char id[MAX_ID_SIZE]; 
+#ifdef MICRORPC_SCHEDULER
+    int8_t priority; // Higher runs first when queued in a Scheduler
+#endif
+#ifdef MICRORPC_CACHE
+    uint8_t idempotent; // Read only: identical commands may be served from the gateway cache
+#endif
+    int ret; // Last return value of the service
     char *desc; 
     rpcFunc func; 
-    char response[MAX_RESPONSE_SIZE]; // Last response of the service
-    int ret; // Last return value of the service
-}Service; // An executable function that can be called by a client
+#ifdef MICRORPC_SCHEDULER
+    unsigned long deadline; // RPC_NOW() ticks a queued command may wait before it is dropped, 0 for none
+#endif
+#ifdef MICRORPC_CACHE
+    unsigned long ttl; // RPC_NOW() ticks a cached response stays valid, 0 until the interface changes
+#endif
+#ifdef MICRORPC_METRICS
+    ServiceStats stats;
+#endif
+}; // An executable function that can be called by a client
 
-typedef struct Interface{
+struct Interface{
+    RPCId key; // Packed id, set by createInterface
     char id[MAX_ID_SIZE]; 
+    uint8_t count; 
+    uint8_t capacity; // Most services the interface can hold
+#ifdef MICRORPC_MULTICAST
+    uint8_t groups; // Bit i set if a member of the gateway's group i
+#endif
+    uint16_t tableSize; // Hash slots, larger than capacity
     Protocol *proto; 
-    Service *services[MAX_SERVICES]; // List of services
-    int count; 
+    Service **services; // List of services, capacity entries
+    unsigned char *table; // Hash slots: service index + 1, 0 if empty
     void *data; // Pointer to interface data
-} Interface; // RPC Services under 
+#ifdef MICRORPC_CACHE
+    unsigned int version; // Bumped when data may have changed, invalidates cached responses
+#endif
+#ifdef MICRORPC_METRICS
+    InterfaceStats stats;
+#endif
+}; // RPC Services under 
+
+#ifdef MICRORPC_CACHE
+typedef struct CacheEntry{
+    Service *service; // 0 if the entry is empty
+    Interface *interface;
+    unsigned int version; // Interface version the response was made at
+    unsigned long stamp; // RPC_NOW() when stored
+    int ret; // Return value of the service
+    int keyLen;
+    int len; // Response bytes
+    char key[RPC_CACHE_KEY_SIZE]; // |len|bytes| of each argument after the service id
+    char response[RPC_CACHE_RESPONSE_SIZE];
+}CacheEntry; // A memoized service response
+
+typedef struct CacheStats{
+    unsigned long hits;
+    unsigned long misses; // Cacheable commands that ran their service
+}CacheStats;
+#endif
+
+#ifdef MICRORPC_ASYNC
+typedef int (*rpcPoll)(Deferred *deferred, Response *response, void *state); // RPC_PENDING until done, then the result
+typedef void (*rpcDeferDone)(Deferred *deferred, void *ctx); // Delivers a completed command
+
+struct Deferred{
+    Command cmd; // Copy of the command, its arguments point into msg
+    Response response; // Response written so far, points into tx
+    rpcPoll poll; // Steps the service, 0 if completed by completeDeferred
+    void *state; // Service state handed to poll
+    void *tag; // Free for the caller, e.g. the connection to answer
+    int busy; // Slot holds a pending command
+    volatile int done; // Set by completeDeferred, may be called from an interrupt
+    int ret; // Result of the service once done
+    char msg[MAX_CMD_SIZE + 1];
+    char tx[RPC_DEFER_TX_SIZE];
+}; // Handle of a command whose service completes later
+#endif
+
+#ifdef MICRORPC_JOURNAL
+typedef void (*rpcJournal)(const Message *msg, void *ctx); // Sees each message before it is parsed
+#endif
 
-typedef struct Gateway{
-    Interface *interfaces[MAX_INTERFACES]; // List of interfaces
-    int count; // Number of interfaces
-}Gateway; // A list of interfaces that can be called by a client
+struct Gateway{
+    Interface **interfaces; // List of interfaces, capacity entries
+    unsigned char *table; // Hash slots: interface index + 1, 0 if empty
+    uint8_t count; // Number of interfaces
+    uint8_t capacity; // Most interfaces the gateway can hold
+    uint16_t tableSize; // Hash slots, larger than capacity
+#ifdef MICRORPC_METRICS
+    GatewayStats stats;
+#endif
+#ifdef MICRORPC_JOURNAL
+    rpcJournal journal; // 0 if disabled
+    void *journalCtx;
+#endif
+#ifdef MICRORPC_ASYNC
+    Deferred *deferred; // deferSize handles from initDeferred, 0 if disabled
+    int deferSize;
+    int pending; // Handles in use
+    rpcDeferDone onDone;
+    void *doneCtx;
+#endif
+#ifdef MICRORPC_CACHE
+    CacheEntry *cache; // cacheSize entries from initCache, 0 if disabled
+    int cacheSize;
+    CacheStats cacheStats;
+#endif
+#ifdef MICRORPC_MULTICAST
+    RPCId groups[RPC_MAX_GROUPS]; // Packed group ids, addGroup order
+    uint8_t groupCount;
+#endif
+}; // A list of interfaces that can be called by a client
+
+typedef struct Parser{
+    Gateway *gateway; 
+    char buf[MAX_CMD_SIZE+1]; // Current frame, the ready command's arguments point here
+    rpcLen len; // Bytes stored for the current frame
+    rpcLen argLen; // Length of the current argument
+    uint8_t argIdx; // Index of the current argument
+    uint8_t discard; // Skipping a rejected frame up to the next terminator
+    char term; // Frame terminator
+}Parser; // Incremental parser for byte stream transports
 
 
 // *** // Setup functions // *** // 
-void initRPC(Gateway *gateway){
+RPCId packId(const char *id, int len){
+    // @brief Pack the first len chars of an id into one integer, char i in byte i
+    // @desc: Packed ids compare in one instruction and never match a prefix, "TS1" != "TS10"
+    // @return: Packed id, or 0 if the id is empty, longer than MAX_ID_SIZE - 1 or holds a '\0'
+    if(len < 1 || len > MAX_ID_SIZE - 1 || len > (int)sizeof(RPCId)) return 0;
+    RPCId key = 0;
+    for(int i = 0; i < len; i++){
+        if(id[i] == '\0') return 0; // Not an id
+        key |= (RPCId)(unsigned char)id[i] << (8 * i);
+    }
+    return key;
+}
+
+static int idSlot(RPCId key, int tableSize){
+    // @brief Home hash slot of a packed id
+    return (int)((uint32_t)(key * 2654435761u) % (uint32_t)tableSize);
+}
+
+void initArena(RPCArena *arena, void *buf, int size){
+    // @brief Hand a static buffer to the registration functions
+    arena->buf = buf;
+    arena->size = size;
+    arena->used = 0;
+}
+
+void *arenaAlloc(RPCArena *arena, int size){
+    // @brief Take size bytes from the arena, aligned for pointers
+    // @return: Pointer to the zeroed bytes or 0 if the arena is exhausted
+    int pad = (int)(-(uintptr_t)(arena->buf + arena->used) & (RPC_ARENA_ALIGN - 1)); // Align the address, not the offset
+    int start = arena->used + pad;
+    if(size < 0 || start > arena->size || size > arena->size - start){
+        return 0; // Arena is exhausted
+    }
+    arena->used = start + size;
+    for(int i = 0; i < size; i++){
+        arena->buf[start + i] = 0;
+    }
+    return arena->buf + start;
+}
+
+static void *allocTable(RPCArena *arena, int capacity, unsigned char **table){
+    // @brief Take a list of capacity pointers and its RPC_TABLE_SLOTS hash slots from the arena
+    // @return: Pointer to the list, or 0 if the capacity is invalid or the arena is exhausted
+    if(capacity < 1 || capacity > RPC_MAX_ENTRIES) return 0;
+    int used = arena->used;
+    void *entries = arenaAlloc(arena, capacity * (int)sizeof(void *));
+    *table = arenaAlloc(arena, RPC_TABLE_SLOTS(capacity));
+    if(entries == 0 || *table == 0){
+        arena->used = used; // Give back a partial allocation
+        return 0;
+    }
+    return entries;
+}
+
+int initRPC(Gateway *gateway, RPCArena *arena, int maxInterfaces){
     // @brief Initialize the Gateway 
-    // @desc: Set all interface pointers to 0
-   for(int i = 0; i < (MAX_INTERFACES); i++){
-        gateway->interfaces[i] = 0; // Set interface table to null
-   }
+    // @desc: The interface table holds maxInterfaces and is taken from the arena
+    // @return: 0 if successful, -1 if the arena is too small
     gateway->count = 0; 
+#ifdef MICRORPC_JOURNAL
+    gateway->journal = 0;
+    gateway->journalCtx = 0;
+#endif
+#ifdef MICRORPC_ASYNC
+    gateway->deferred = 0;
+    gateway->deferSize = 0;
+    gateway->pending = 0;
+#endif
+#ifdef MICRORPC_CACHE
+    gateway->cache = 0;
+    gateway->cacheSize = 0;
+    gateway->cacheStats.hits = 0;
+    gateway->cacheStats.misses = 0;
+#endif
+#ifdef MICRORPC_MULTICAST
+    gateway->groupCount = 0;
+#endif
+    gateway->interfaces = allocTable(arena, maxInterfaces, &gateway->table);
+    if(gateway->interfaces == 0){
+        gateway->capacity = 0;
+        gateway->tableSize = 0;
+        return -1; // Arena is too small
+    }
+    gateway->capacity = maxInterfaces;
+    gateway->tableSize = RPC_TABLE_SLOTS(maxInterfaces);
+    return 0;
 }
 
-void createInterface(Interface *interface, char *id, Protocol *proto, void *data ){
+int createInterface(Interface *interface, char *id, Protocol *proto, void *data, RPCArena *arena, int maxServices){
     // @brief Create an interface object 
     // @desc: Set the interface id, protocol, and data
+    // @desc: The service table holds maxServices and is taken from the arena
+    // @desc: The protocol's argument ids are packed for extractArg
+    // @desc: seqIdx must name an argument after the service id
+    // @desc: With MICRORPC_SCHEDULER so must priorityIdx (ARG_INT) and deadlineIdx (ARG_INT or ARG_UINT)
+    // @return: 0 if successful, -1 if the arena is too small, the id or the protocol is invalid
     uCcpy(interface->id, id);
+    interface->key = packId(id, uCsize(id) - 1);
     interface->proto = proto;
     interface->count = 0;
     interface->data = data;
-    for(int i = 0; i < MAX_SERVICES; i++){
-        interface->services[i] = 0; // Initialize the service table to 0
+#ifdef MICRORPC_MULTICAST
+    interface->groups = 0;
+#endif
+    int valid = interface->key != 0 && proto->numArgs <= MAX_ARGS
+                && (proto->seqIdx == 0 || (proto->seqIdx > SERVICE_IDX && proto->seqIdx < proto->numArgs));
+#ifdef MICRORPC_SCHEDULER
+    // Priority and deadline fields are read as numbers
+    valid = valid && (proto->priorityIdx == 0 || (proto->priorityIdx > SERVICE_IDX && proto->priorityIdx < proto->numArgs
+                      && proto->cmdFormat[proto->priorityIdx].type == ARG_INT));
+    valid = valid && (proto->deadlineIdx == 0 || (proto->deadlineIdx > SERVICE_IDX && proto->deadlineIdx < proto->numArgs
+                      && (proto->cmdFormat[proto->deadlineIdx].type == ARG_INT || proto->cmdFormat[proto->deadlineIdx].type == ARG_UINT)));
+#endif
+    for(int i = 0; valid && i < proto->numArgs; i++){
+        proto->cmdFormat[i].key = packId(proto->cmdFormat[i].id, uCsize(proto->cmdFormat[i].id) - 1);
+    }
+    interface->services = valid ? allocTable(arena, maxServices, &interface->table) : 0;
+    if(interface->services == 0){
+        interface->capacity = 0;
+        interface->tableSize = 0;
+        return -1; // Arena is too small or invalid protocol
+    }
+    interface->capacity = maxServices;
+    interface->tableSize = RPC_TABLE_SLOTS(maxServices);
+    return 0;
+}
+
+#ifdef MICRORPC_ASYNC
+int initDeferred(Gateway *gateway, RPCArena *arena, int count, rpcDeferDone onDone, void *ctx){
+    // @brief Give the gateway count handles for deferred commands taken from the arena
+    // @desc: onDone runs inside pollDeferred for every command that completes
+    // @note: Size the arena with count * sizeof(Deferred) more bytes
+    // @return: 0 if successful, -1 if the arena is too small
+    Deferred *deferred = (count > 0) ? arenaAlloc(arena, count * (int)sizeof(Deferred)) : 0;
+    if(deferred == 0) return -1; // Arena is too small
+    gateway->deferred = deferred;
+    gateway->deferSize = count;
+    gateway->onDone = onDone;
+    gateway->doneCtx = ctx;
+    return 0;
+}
+#endif
+
+#ifdef MICRORPC_CACHE
+int initCache(Gateway *gateway, RPCArena *arena, int entries){
+    // @brief Give the gateway a response cache of entries slots taken from the arena
+    // @note: Size the arena with entries * sizeof(CacheEntry) more bytes
+    // @return: 0 if successful, -1 if the arena is too small
+    CacheEntry *cache = (entries > 0) ? arenaAlloc(arena, entries * (int)sizeof(CacheEntry)) : 0;
+    if(cache == 0) return -1; // Arena is too small
+    gateway->cache = cache;
+    gateway->cacheSize = entries;
+    return 0;
+}
+
+void touchInterface(Interface *interface){
+    // @brief Drop the cached responses of an interface, call after changing its data outside a service
+    interface->version++;
+}
+#endif
+
+#ifdef MICRORPC_JOURNAL
+void setJournal(Gateway *gateway, rpcJournal journal, void *ctx){
+    // @brief Hand every message the gateway parses to journal, 0 disables it. Frames rejected before they are complete are not journaled
+    // @desc: updateCommand journals every message. feedParser journals a frame at its terminator, so one
+    // @desc: rejected earlier on an invalid byte, argument or length is discarded unrecorded, and
+    // @desc: updateCommandRing skips frames over MAX_CMD_SIZE
+    // @note: A replay reproduces the accepted load and the late rejects, not these early rejects
+    gateway->journal = journal;
+    gateway->journalCtx = ctx;
+}
+#endif
+
+static int interfaceSlot(Gateway *gateway, RPCId key){
+    // @brief Find the hash slot of a packed interface id using linear probing
+    // @return: Slot holding the id, or -(free slot + 1) if the id is not in the table
+    // @note: The table is larger than its capacity, so a free slot always ends the probe
+    if(gateway->tableSize == 0) return -1; // Gateway has no table
+    int slot = idSlot(key, gateway->tableSize);
+    while(gateway->table[slot] != 0){
+        if(gateway->interfaces[gateway->table[slot] - 1]->key == key){
+            return slot; // Id found
+        }
+        slot = (slot + 1) % gateway->tableSize;
+    }
+    return -(slot + 1); // Id is not in the table
+}
+
+static int serviceSlot(Interface *interface, RPCId key){
+    // @brief Find the hash slot of a packed service id using linear probing
+    // @return: Slot holding the id, or -(free slot + 1) if the id is not in the table
+    // @note: The table is larger than its capacity, so a free slot always ends the probe
+    if(interface->tableSize == 0) return -1; // Interface has no table
+    int slot = idSlot(key, interface->tableSize);
+    while(interface->table[slot] != 0){
+        if(interface->services[interface->table[slot] - 1]->key == key){
+            return slot; // Id found
+        }
+        slot = (slot + 1) % interface->tableSize;
+    }
+    return -(slot + 1); // Id is not in the table
+}
+
+#ifdef MICRORPC_MULTICAST
+static int groupIndex(Gateway *gateway, RPCId key){
+    // @brief Find a group by packed id
+    // @return: Group index, or -1 if the group does not exist
+    for(int i = 0; key != 0 && i < gateway->groupCount; i++){
+        if(gateway->groups[i] == key) return i;
     }
+    return -1;
 }
+#endif
 
 int addInterface(Gateway *gateway, Interface *interface){
     // @brief Add an interface to the Gateway incremtaly 
     // @desc: Add a pointer to the interface to the Gateway's interface table
-    // @note: Collision resolution is not implemented
-    if (gateway->count+1 > MAX_INTERFACES){
-        return -1; // Interface table is full
+    // @desc: Index the interface by hash id, collisions are resolved by linear probing
+    // @return: 0 if successful, -1 if the table is full, the id is invalid or already exists
+    // @note: With MICRORPC_MULTICAST an id naming a group already exists too
+    if (gateway->count+1 > gateway->capacity || interface->key == 0){
+        return -1; // Interface table is full or the interface was not created
     }
-    //int idx = hash(interface->id, MAX_INTERFACES); REMOVIG HASHING FOR NOW
-    if(gateway->interfaces[gateway->count] != 0){
-        return -1; // Interface already exists at this index
+    int slot = interfaceSlot(gateway, interface->key);
+    if(slot >= 0){
+        return -1; // Interface id already exists
     }
+#ifdef MICRORPC_MULTICAST
+    if(groupIndex(gateway, interface->key) >= 0){
+        return -1; // Id names a group
+    }
+#endif
     gateway->interfaces[gateway->count] = interface;
     gateway->count++;
+    gateway->table[-slot - 1] = gateway->count; // Store index + 1
     return 0;
 }
 
 int registerService(Interface *interface, Service *service){
     // @brief Add a service to an interface by hash id
-    //int idx = hash(service->id, MAX_SERVICES); REMOVIG HASHING FOR NOW
-    if(interface->services[interface->count] != 0){
-        return -1; // Service already exists at this index
+    // @desc: Collisions are resolved by linear probing
+    // @return: 0 if successful, -1 if the table is full, the id is invalid or already exists
+    if(interface->count+1 > interface->capacity){
+        return -1; // Service table is full
+    }
+    service->key = packId(service->id, uCsize(service->id) - 1);
+    if(service->key == 0){
+        return -1; // Service id is empty or too long
+    }
+    int slot = serviceSlot(interface, service->key);
+    if(slot >= 0){
+        return -1; // Service id already exists
     }
     interface->services[interface->count] = service;
     interface->count++;
+    interface->table[-slot - 1] = interface->count; // Store index + 1
+    return 0;
+}
+
+#ifdef MICRORPC_MULTICAST
+int addGroup(Gateway *gateway, char *id){
+    // @brief Add a multicast group, a message targeting its id runs on every member interface
+    // @desc: The id is matched like a target, so it must be TARGET_ARG_LEN chars
+    // @return: 0 if successful, -1 if the groups are full, the id is invalid or already taken
+    RPCId key = (uCsize(id) - 1 == TARGET_ARG_LEN) ? packId(id, TARGET_ARG_LEN) : 0;
+    if(gateway->groupCount >= RPC_MAX_GROUPS || key == 0){
+        return -1; // Groups are full or invalid id
+    }
+    if(interfaceSlot(gateway, key) >= 0 || groupIndex(gateway, key) >= 0){
+        return -1; // Id names an interface or a group already
+    }
+    gateway->groups[gateway->groupCount++] = key;
     return 0;
 }
 
+int joinGroup(Gateway *gateway, Interface *interface, char *id){
+    // @brief Make an interface a member of a group of the gateway
+    // @return: 0 if successful, -1 if the group does not exist
+    int group = groupIndex(gateway, packId(id, uCsize(id) - 1));
+    if(group < 0) return -1; // Group does not exist
+    interface->groups |= (uint8_t)(1u << group);
+    return 0;
+}
+#endif
+
 
 // *** // Internal functions // *** //
+static Interface *lookupInterface(Gateway *gateway, const char *id, int len){
+    // @brief Get an interface from the Gateway by the first len chars of id
+    // @return: Pointer to the interface or 0 if not found
+    RPCId key = packId(id, len);
+    if(key == 0) return 0; // Not a valid id
+    int slot = interfaceSlot(gateway, key);
+    if(slot < 0) return 0; // Interface does not exist
+    return gateway->interfaces[gateway->table[slot] - 1];
+}
+
+static Service *lookupService(Interface *interface, const char *id, int len){
+    // @brief Get a service from an interface by the first len chars of id
+    // @return: Pointer to the service or 0 if not found
+    RPCId key = packId(id, len);
+    if(key == 0) return 0; // Not a valid id
+    int slot = serviceSlot(interface, key);
+    if(slot < 0) return 0; // Service does not exist
+    return interface->services[interface->table[slot] - 1];
+}
+
 Interface *getInterface(Gateway *gateway, char *id){
     // @brief Get an interface from the Gateway by id
     // @return: Pointer to the interface or 0 if not found
+    return lookupInterface(gateway, id, uCsize(id) - 1);
+}
+
+static Service *getService(Interface *interface, char *id){
+    // @brief Get a service from an interface by hash id
+    // @return: Pointer to the service or 0 if not found
+    return lookupService(interface, id, uCsize(id) - 1);
+}
+
+#ifdef MICRORPC_MULTICAST
+static int castMatch(Command *cmd, Interface *interface){
+    // @brief Check if an interface is selected by the command's multicast target
+    if(cmd->cast == CAST_GROUP) return (interface->groups & cmd->castMask) != 0;
+    return (interface->key & cmd->castMask) == cmd->castKey;
+}
+
+static Interface *findCast(Command *cmd, Gateway *gateway, const char *id){
+    // @brief Resolve a target of TARGET_ARG_LEN chars naming a group or holding RPC_WILDCARD
+    // @desc: Sets the command's multicast target, invokeService matches the interfaces again
+    // @return: First matching interface of a text protocol, or 0 if the target matches none
+    RPCId key = packId(id, TARGET_ARG_LEN);
+    cmd->castGateway = gateway;
+    int group = groupIndex(gateway, key);
+    if(group >= 0){
+        cmd->cast = CAST_GROUP;
+        cmd->castMask = 1u << group;
+    }
+    else{
+        RPCId mask = ~(RPCId)0; // Bytes past the target stay compared, longer ids never match
+        for(int i = 0; key != 0 && i < TARGET_ARG_LEN; i++){
+            if(id[i] == RPC_WILDCARD) mask &= ~((RPCId)0xFF << (8 * i));
+        }
+        if(key == 0 || mask == ~(RPCId)0) return 0; // Neither a group nor a pattern
+        cmd->cast = CAST_PATTERN;
+        cmd->castKey = key & mask;
+        cmd->castMask = mask;
+    }
     for(int i = 0; i < gateway->count; i++){
-        if(uStrcmp(gateway->interfaces[i]->id, id) == 0){
-            return gateway->interfaces[i];
+        Interface *interface = gateway->interfaces[i];
+        if(interface->proto->mode == PROTO_TEXT && castMatch(cmd, interface)){
+            return interface; // Its protocol parses the message
         }
     }
+    cmd->cast = CAST_NONE;
     return 0;
 }
+#endif
 
-static Service *getService(Interface *interface, char *id){
-    // @brief Get a service from an interface by hash id
-    // @return: Pointer to the service or 0 if not found
-    for(int i = 0; i < interface->count; i++){
-        if(uStrcmp(interface->services[i]->id, id) == 0){
-            return interface->services[i];
+static Interface *targetInterface(Command *cmd, Gateway *gateway, const char *id){
+    // @brief Resolve the TARGET_ARG_LEN chars of a message's target
+    // @desc: With MICRORPC_MULTICAST a target that is no interface id may select several
+    // @return: Pointer to the target interface, or the first of a multicast target, 0 if not found
+    Interface *interface = lookupInterface(gateway, id, TARGET_ARG_LEN);
+#ifdef MICRORPC_MULTICAST
+    cmd->cast = CAST_NONE;
+    if(interface == 0){
+        interface = findCast(cmd, gateway, id);
+    }
+#endif
+    return interface;
+}
+
+static Service *resolveService(Command *cmd, Gateway *gateway, const char *id, int len){
+    // @brief Resolve the service of a command on its target interface
+    // @desc: A multicast command falls back to the first selected interface offering the service,
+    // @desc: which becomes the command's interface
+    // @return: Pointer to the service or 0 if no target offers it
+    Service *service = lookupService(cmd->interface, id, len);
+#ifdef MICRORPC_MULTICAST
+    for(int i = 0; service == 0 && cmd->cast != CAST_NONE && i < gateway->count; i++){
+        Interface *member = gateway->interfaces[i];
+        if(member->proto == cmd->proto && castMatch(cmd, member)){
+            service = lookupService(member, id, len);
+            if(service != 0) cmd->interface = member;
+        }
+    }
+#endif
+    return service;
+}
+
+static Interface *findInterface(Command *cmd, Gateway *gateway, Message *msgCmd){
+    // @brief Find the target interface of a message
+    // @desc: Look up the target interface by the first TARGET_ARG_LEN chars of the message
+    // @return: Pointer to the target interface or 0 if not found
+    int len = 0;
+    while(len < TARGET_ARG_LEN && len < msgCmd->len && msgCmd->buf[len] != '\0'){
+        len++;
+    }
+    if(len != TARGET_ARG_LEN) return 0; // Target argument is not the correct length
+    return targetInterface(cmd, gateway, msgCmd->buf);
+}
+
+static int decodeBinaryArg(CmdArg *format, Message *arg, ArgValue *value){
+    // @brief Decode a little endian binary argument
+    // @return: 0 if successful, -1 if the argument does not fit its type
+    if(arg->len > (int)sizeof(unsigned long)) return -1; // Too wide for a number
+    if(format->type == ARG_FLOAT){
+        if(arg->len != sizeof(float)) return -1; // Not an IEEE 754 single
+        unsigned char *dst = (unsigned char *)&value->f;
+        for(int i = 0; i < arg->len; i++){
+            dst[i] = arg->buf[i];
         }
+        return 0;
+    }
+    unsigned long raw = 0;
+    for(int i = arg->len - 1; i >= 0; i--){
+        raw = (raw << 8) | (unsigned char)arg->buf[i];
+    }
+    int bits = arg->len * 8;
+    if((format->type == ARG_INT || format->type == ARG_FIXED) && bits < (int)sizeof(long) * 8
+       && (raw >> (bits - 1)) & 1){
+        raw |= ~0UL << bits; // Sign extend
     }
+    value->u = raw;
     return 0;
 }
 
-static Protocol *findProtocol(Gateway *gateway, Message *msgCmd){
-    // @brief Find the protocol of the target interface
-    // @desc: Parse the message and find the target interface 
-    // @desc: Return pointer to the protocol of the target interface or 0 if not found
+static int decodeTextArg(ArgType type, int scale, Message *arg, ArgValue *value){
+    // @brief Decode a text argument slice into its value
+    // @desc: Inlined with constant type and scale by the parsers RPC_PROTOCOL generates
+    // @return: 0 if successful, -1 if the argument is not a valid value of its type
+    value->u = 0;
+    if(type == ARG_STR) return 0; // The slice is the value
+    if(arg->len == 0) return 0; // Empty arguments decode to 0
+    switch(type){
+    case ARG_INT:
+        return uCtoInt(arg->buf, arg->len, &value->i);
+    case ARG_UINT:
+        return uCtoUint(arg->buf, arg->len, 10, &value->u);
+    case ARG_HEX:
+        return uCtoUint(arg->buf, arg->len, 16, &value->u);
+    case ARG_FIXED:
+        return uCtoFixed(arg->buf, arg->len, scale, &value->i);
+    case ARG_FLOAT:
+        return uCtoFloat(arg->buf, arg->len, &value->f);
+    default:
+        return -1; // Unknown type
+    }
+}
+
+static int decodeArg(Command *cmd, int argIdx){
+    // @brief Decode an argument slice into cmd->argv by the type declared in the protocol
+    // @desc: Called as each argument is sliced, so the message is only walked once
+    // @return: 0 if successful, -1 if the argument is not a valid value of its type
+    CmdArg *format = &cmd->proto->cmdFormat[argIdx];
+    Message *arg = &cmd->args[argIdx];
+    ArgValue *value = &cmd->argv[argIdx];
+    if(cmd->proto->mode == PROTO_TEXT || format->type == ARG_STR){
+        return decodeTextArg(format->type, format->scale, arg, value);
+    }
+    value->u = 0;
+    if(arg->len == 0) return 0; // Empty arguments decode to 0
+    return decodeBinaryArg(format, arg, value);
+}
+
+static int updateFixedArguments(Command *cmd, Message *msgCmd){
+    // @brief Update the arguments of the command from a fixed width binary message
+    // @desc: Argument i is cmdFormat[i].maxSize bytes following argument i-1, no bytes are scanned
+    // @return: 0 if successful, -1 if the message length does not match the protocol
+    Protocol *proto = cmd->proto;
+    int offset = 0;
+    for(int i = 0; i < proto->numArgs; i++){
+        offset += proto->cmdFormat[i].maxSize;
+    }
+    if(offset != msgCmd->len) return -1; // Message is not the size of the protocol
+    offset = 0;
+    for(int i = 0; i < proto->numArgs; i++){
+        cmd->args[i].buf = &msgCmd->buf[offset];
+        cmd->args[i].len = proto->cmdFormat[i].maxSize;
+        if(decodeArg(cmd, i) != 0) return -1; // Invalid value
+        offset += proto->cmdFormat[i].maxSize;
+    }
+    return 0;
+}
 
-    // Get the target interface id from the message Command
-    char targetId[TARGET_ARG_LEN+1];
-    int lenTrunk = uCTrunk(targetId, msgCmd->buf, 0,TARGET_ARG_LEN); 
-    if(lenTrunk != TARGET_ARG_LEN) return 0; // Target argument is not the correct length
-    // Get the target interface's protocol from the Gateway
-    Interface *interface = getInterface(gateway, targetId);
-    if(interface == 0) return 0; // Target interface does not exist
-    // Return the protocol of the target interface
-    return interface->proto;
+static int updateTlvArguments(Command *cmd, Message *msgCmd){
+    // @brief Update the arguments of the command from a binary TLV message
+    // @desc: The target id is followed by |type|len|value| records, type indexes cmdFormat
+    // @desc: Records are walked by their length prefix, values are not scanned
+    // @return: 0 if successful, -1 if a record is malformed
+    Protocol *proto = cmd->proto;
+    unsigned char *buf = (unsigned char *)msgCmd->buf;
+    cmd->args[TARGET_IDX].buf = msgCmd->buf;
+    cmd->args[TARGET_IDX].len = TARGET_ARG_LEN;
+    if(decodeArg(cmd, TARGET_IDX) != 0) return -1; // Invalid value
+    int i = TARGET_ARG_LEN;
+    while(i < msgCmd->len){
+        if(i + 2 > msgCmd->len) return -1; // Truncated record header
+        int type = buf[i];
+        int len = buf[i + 1];
+        if(type == TARGET_IDX || type >= proto->numArgs) return -1; // Unknown argument
+        if(cmd->args[type].buf != 0) return -1; // Duplicate argument
+        if(len >= proto->cmdFormat[type].maxSize) return -1; // Argument is too long
+        if(i + 2 + len > msgCmd->len) return -1; // Truncated record value
+        cmd->args[type].buf = &msgCmd->buf[i + 2];
+        cmd->args[type].len = len;
+        if(decodeArg(cmd, type) != 0) return -1; // Invalid value
+        i += 2 + len;
+    }
+    return 0;
 }
 
-static int updateArguments(Message *msgCmd, Protocol *proto){
-    // @brief Update the arguments of the protocol with the message
-    // @desc: Parse the message and update the protocol arguments zero copy
+static int updateArguments(Command *cmd, Message *msgCmd){
+    // @brief Update the arguments of the command with the message
+    // @desc: Parse the message into the command's argument slices zero copy
     // @desc: Validate Argument lengths against the protocol
+    // @note: The protocol is only read, so commands for one interface can be parsed concurrently
     // @return: 0 if successful, -1 if error
 
-    if(msgCmd == 0 || proto == 0) return -1; // Null pointer
+    if(msgCmd == 0 || cmd->proto == 0) return -1; // Null pointer
+    Protocol *proto = cmd->proto;
+    if(proto->parse != 0) return proto->parse(cmd, msgCmd); // Specialized for this layout
+    if(proto->mode == PROTO_FIXED) return updateFixedArguments(cmd, msgCmd);
+    if(proto->mode == PROTO_TLV) return updateTlvArguments(cmd, msgCmd);
 
-    int argLen = 0; // Length of the current argument
+    int start = 0; // Index of the current argument in message
     int argIdx = 0; // Index of argument in message
-    int delimIdx[proto->numArgs]; // Index of delimiter found
-    for(int i = 0; i < msgCmd->len; i++){
-        // Check for delimiter or end of message
-        if(msgCmd->buf[i] == proto->delim || msgCmd->buf[i] == '\0'){
-            if (argIdx == proto->numArgs ) return -1; // Too many arguments
-            if( argLen >= proto->cmdFormat[argIdx].maxSize) return -1; // Argument is too long
-    
-            delimIdx[argIdx] = i; // Store the index of the delimiter   
-            // Assign the argument to the protocol 
-            // TODO: THIS SEEMS IS HACKY.
-            proto->cmdFormat[argIdx].str.buf = &msgCmd->buf[i-argLen]; // Point to start of arg
-            proto->cmdFormat[argIdx].str.len = argLen; // Set the length of the arg
-            argLen = 0; 
-            argIdx++; 
-        }
-        else{
-            argLen++;
-        }
+    while(start < msgCmd->len){
+        // Find the next delimiter or end of message
+        int i = uCscan(msgCmd->buf, start, msgCmd->len, proto->delim, '\0');
+        if(i == msgCmd->len) break; // Argument is not terminated
+        int argLen = i - start; // Length of the current argument
+        if (argIdx == proto->numArgs ) return -1; // Too many arguments
+        if( argLen >= proto->cmdFormat[argIdx].maxSize) return -1; // Argument is too long
+
+        // Assign the argument to the command
+        cmd->args[argIdx].buf = &msgCmd->buf[start]; // Point to start of arg
+        cmd->args[argIdx].len = argLen; // Set the length of the arg
+        if(decodeArg(cmd, argIdx) != 0) return -1; // Invalid value
+        argIdx++; 
+        start = i + 1;
     }
     return 0;
 }
 
 
 
+static int hasSequence(Command *cmd){
+    // @brief Check that a command of a pipelined protocol carries its correlation id
+    // @return: 1 if the protocol has no correlation id or the argument is present, 0 if missing
+    return cmd->proto->seqIdx == 0 || cmd->args[cmd->proto->seqIdx].len != 0;
+}
+
+static int rejectCommand(Command *cmd, Gateway *gateway, RejectReason reason){
+    // @brief Mark the command invalid and count the reason
+    // @return: -1
+    cmd->valid = 0;
+    cmd->reject = reason;
+#ifdef MICRORPC_METRICS
+    RPC_STAT_ADD(gateway->stats.rejects[reason], 1);
+#endif
+    return -1;
+}
+
+static void acceptCommand(Command *cmd, Gateway *gateway, int len){
+    // @brief Mark the command valid and count it
+    cmd->valid = 1;
+    cmd->reject = REJECT_NONE;
+#ifdef MICRORPC_METRICS
+    RPC_STAT_ADD(gateway->stats.accepted, 1);
+    RPC_STAT_ADD(cmd->interface->stats.commands, 1);
+    RPC_STAT_ADD(cmd->interface->stats.bytes, len);
+#endif
+}
+
+#ifdef MICRORPC_METRICS
+static int histBucket(unsigned long ticks){
+    // @brief Log2 histogram bucket of a latency
+#if defined(__GNUC__)
+    int bucket = (ticks == 0) ? 0 : (int)(sizeof(unsigned long) * 8) - __builtin_clzl(ticks);
+#else
+    int bucket = 0;
+    for(; ticks != 0; ticks >>= 1){
+        bucket++;
+    }
+#endif
+    return (bucket < RPC_HIST_BUCKETS) ? bucket : RPC_HIST_BUCKETS - 1;
+}
+#endif
+
+
+
 // *** // **** User Exposed Functions **** // *** //
 void clearCommand(Command *cmd){
     // @brief Clear the command 
     cmd->valid = 0;
-    if(cmd->proto != 0){
-        for(int i =0; i < MAX_ARGS; i++){
-            cmd->proto->cmdFormat[i].str.buf = 0; // Set the buffer to null
-            cmd->proto->cmdFormat[i].str.len = 0; // Set the length to 0
-        }
-        cmd->proto = 0; // Unassign the protocol
+    for(int i =0; i < MAX_ARGS; i++){
+        cmd->args[i].buf = 0; // Set the buffer to null
+        cmd->args[i].len = 0; // Set the length to 0
+        cmd->argv[i].u = 0; // Zero the widest value member
     }
-    
+    cmd->proto = 0; // Unassign the protocol
+    cmd->interface = 0;
+    cmd->service = 0;
+    cmd->reject = REJECT_NONE;
+#ifdef MICRORPC_MULTICAST
+    cmd->cast = CAST_NONE;
+#endif
 }
 
 void clearServiceResponse(Service *service){
-    // @brief Clear the service response
-    // @desc: Clear the service response by setting the length to 0
-    for(int i =0; i< MAX_RESPONSE_SIZE; i++){
-        service->response[i] = 0;
-    }
+    // @brief Clear the last return value of the service
     service->ret = 0;
 }
 
+void initResponse(Response *response, char *buf, int size){
+    // @brief Point a response sink at a caller supplied buffer
+    // @desc: Services write straight into buf, size includes room for the null terminator
+    response->buf = buf;
+    response->size = size;
+    response->len = 0;
+    response->overflow = 0;
+    if(size > 0) buf[0] = '\0';
+}
+
+int writeResponse(Response *response, const char *data, int len){
+    // @brief Append len bytes to the response
+    // @return: 0 if successful, -1 if the bytes do not fit, nothing is written then
+    if(response->len + len > response->size - 1){
+        response->overflow = 1;
+        return -1; // Response buffer is full
+    }
+    for(int i = 0; i < len; i++){
+        response->buf[response->len++] = data[i];
+    }
+    response->buf[response->len] = '\0';
+    return 0;
+}
+
+int putResponse(Response *response, const char *str){
+    // @brief Append a null terminated string to the response
+    // @return: 0 if successful, -1 if the string does not fit
+    return writeResponse(response, str, uCsize((char *)str) - 1);
+}
+
+char *reserveResponse(Response *response, int *avail){
+    // @brief Get the free space of the response to format into in place
+    // @desc: Write at most *avail bytes, then call commitResponse with the count written
+    *avail = response->size - 1 - response->len;
+    if(*avail < 0) *avail = 0;
+    return response->buf + response->len;
+}
+
+int commitResponse(Response *response, int len){
+    // @brief Account bytes written in place after reserveResponse
+    // @return: 0 if successful, -1 if len exceeds the free space
+    if(len < 0 || response->len + len > response->size - 1){
+        response->overflow = 1;
+        return -1;
+    }
+    response->len += len;
+    response->buf[response->len] = '\0';
+    return 0;
+}
+
+static int bindCommand(Command *cmd, Gateway *gateway, Interface *interface, int len, int bytes){
+    // @brief Point the command at its target interface and drop the previous message's arguments
+    // @desc: len is checked against the protocol's maxCmdLen, the bytes without a '\0' against MAX_CMD_SIZE
+    // @return: 0 if successful, -1 if the target does not exist or the message is too long
+    cmd->interface = interface;
+    cmd->service = 0;
+    if(cmd->interface == 0){
+        cmd->proto = 0;
+        return rejectCommand(cmd, gateway, REJECT_TARGET); // Target interface does not exist
+    }
+    cmd->proto = cmd->interface->proto;
+    // Check if the command is of the correct length
+    if(len > cmd->proto->maxCmdLen || bytes > MAX_CMD_SIZE){
+        return rejectCommand(cmd, gateway, REJECT_LENGTH); // msg is too long
+    }
+    for(int i = 0; i < MAX_ARGS; i++){
+        cmd->args[i].buf = 0; // Drop the arguments of the previous message
+        cmd->args[i].len = 0;
+        cmd->argv[i].u = 0; // Zero the widest value member
+    }
+    return 0;
+}
+
+static int resolveCommand(Command *cmd, Gateway *gateway, int len){
+    // @brief Complete a command whose arguments are parsed: check them and resolve the service
+    // @return: 0 if the command is valid, -1 if rejected
+    if(hasSequence(cmd) == 0){
+        return rejectCommand(cmd, gateway, REJECT_ARGS); // Correlation id is missing
+    }
+    // Resolve the target service, binary ids may be padded with '\0'
+    Message *serviceId = &cmd->args[SERVICE_IDX];
+    int idLen = uCscan(serviceId->buf, 0, serviceId->len, '\0', '\0');
+    cmd->service = resolveService(cmd, gateway, serviceId->buf, idLen);
+    if(cmd->service == 0){
+        return rejectCommand(cmd, gateway, REJECT_SERVICE); // Service does not exist
+    }
+    acceptCommand(cmd, gateway, len);
+    return 0; 
+}
+
 int updateCommand(Command *cmd, Message *msgCmd, Gateway *gateway){
     // @brief Update the command with the message
     // @desc: Parse the message and update the command
-    // @return: 0 if successful, -1 if error
-    cmd->proto = findProtocol(gateway, msgCmd);
-    if(cmd->proto == 0){
-        cmd->valid = 0;
-        return -1; // Target interface does not exist
+    // @desc: The target interface and service are resolved once and cached in the command
+    // @return: 0 if successful, -1 if error, cmd->reject tells why
+#ifdef MICRORPC_JOURNAL
+    if(gateway->journal != 0){
+        gateway->journal(msgCmd, gateway->journalCtx);
     }
-    // Check if the command is of the correct length
-    if(msgCmd->len > cmd->proto->maxCmdLen){
-        cmd->valid = 0;
-        return -1; // msg is too long
+#endif
+    int bytes = msgCmd->len - (msgCmd->len > 0 && msgCmd->buf[msgCmd->len - 1] == '\0');
+    if(bindCommand(cmd, gateway, findInterface(cmd, gateway, msgCmd), msgCmd->len, bytes) != 0){
+        return -1; // Unknown target or msg is too long
     }
     // Validate message against the target interfaces's protocol
-    cmd->valid = !updateArguments(msgCmd, cmd->proto);
-    return 0; 
+    if(updateArguments(cmd, msgCmd) != 0){
+        return rejectCommand(cmd, gateway, REJECT_ARGS); // Arguments do not match the protocol
+    }
+    return resolveCommand(cmd, gateway, msgCmd->len);
 }
 
-int execCommand(Command *cmd, Gateway *gateway){
-    // @brief Execute the command 
-    //  @desc: Execute the command by calling the target service 
-    //  @return: 0 if successful, -1 if error
+static void putSequence(Command *cmd, Response *response){
+    // @brief Start a response with the command's correlation id, in the protocol's wire format
+    // @desc: Text: seq then delim, PROTO_FIXED: the seq field, PROTO_TLV: a |seqIdx|len|seq| record
+    Protocol *proto = cmd->proto;
+    Message *seq = &cmd->args[proto->seqIdx];
+    if(proto->mode == PROTO_TLV){
+        char header[2] = {(char)proto->seqIdx, (char)seq->len};
+        writeResponse(response, header, 2);
+    }
+    writeResponse(response, seq->buf, seq->len);
+    if(proto->mode == PROTO_TEXT){
+        writeResponse(response, &proto->delim, 1);
+    }
+}
+
+static int callService(Command *cmd, Response *response){
+    // @brief Call the service function of a valid command, timed with metrics
+    // @desc: With MICRORPC_CACHE a non idempotent service drops the interface's cached responses
+    Service *service = cmd->service;
+#ifdef MICRORPC_CACHE
+    if(service->idempotent == 0){
+        cmd->interface->version++; // The service may write the interface data
+    }
+#endif
+#ifdef MICRORPC_METRICS
+    unsigned long start = RPC_NOW();
+    int ret = service->func(cmd, response, cmd->interface->data);
+    unsigned long ticks = RPC_NOW() - start;
+    RPC_STAT_ADD(service->stats.calls, 1);
+    RPC_STAT_ADD(service->stats.totalTicks, ticks);
+    RPC_STAT_ADD(service->stats.hist[histBucket(ticks)], 1);
+    if(ticks > service->stats.maxTicks){
+        service->stats.maxTicks = ticks; // Racy under threads, good enough for a maximum
+    }
+    return ret;
+#else
+    return service->func(cmd, response, cmd->interface->data);
+#endif
+}
+
+#ifdef MICRORPC_CACHE
+static int cacheKey(Command *cmd, char *key){
+    // @brief Serialize the arguments after the service id, except the correlation id, as |len|bytes|
+    // @return: Key length, or -1 if the arguments do not fit RPC_CACHE_KEY_SIZE
+    int len = 0;
+    for(int i = SERVICE_IDX + 1; i < cmd->proto->numArgs; i++){
+        if(i == cmd->proto->seqIdx) continue; // Differs per request, not part of the response
+        Message *arg = &cmd->args[i];
+        if(len + 1 + arg->len > RPC_CACHE_KEY_SIZE) return -1; // Too long to cache
+        key[len++] = (char)arg->len;
+        for(int j = 0; j < arg->len; j++){
+            key[len++] = arg->buf[j];
+        }
+    }
+    return len;
+}
+
+static int cachedService(Command *cmd, Gateway *gateway, Response *response){
+    // @brief Run an idempotent service through the gateway cache
+    // @desc: A hit writes the stored response, a miss runs the service and stores its response
+    // @return: Return value of the service
+    char key[RPC_CACHE_KEY_SIZE];
+    int keyLen = cacheKey(cmd, key);
+    if(keyLen < 0) return callService(cmd, response); // Not cacheable
+    Service *service = cmd->service;
+    Interface *interface = cmd->interface;
+    unsigned int h = hashKey(key, keyLen) ^ (unsigned int)(uintptr_t)service;
+    CacheEntry *entry = &gateway->cache[h % (unsigned int)gateway->cacheSize];
+    unsigned long now = RPC_NOW();
+    if(entry->service == service && entry->interface == interface && entry->version == interface->version
+       && entry->keyLen == keyLen && uCncmp(entry->key, key, keyLen) == 0
+       && (service->ttl == 0 || now - entry->stamp < service->ttl)){
+        gateway->cacheStats.hits++;
+        writeResponse(response, entry->response, entry->len);
+        return entry->ret;
+    }
+    gateway->cacheStats.misses++;
+    int start = response->len;
+    int ret = callService(cmd, response);
+    int len = response->len - start;
+    if(ret != RPC_PENDING && response->overflow == 0 && len <= RPC_CACHE_RESPONSE_SIZE){
+        // Replace whatever held the slot
+        entry->service = service;
+        entry->interface = interface;
+        entry->version = interface->version;
+        entry->stamp = now;
+        entry->ret = ret;
+        entry->keyLen = keyLen;
+        entry->len = len;
+        for(int i = 0; i < keyLen; i++){
+            entry->key[i] = key[i];
+        }
+        for(int i = 0; i < len; i++){
+            entry->response[i] = response->buf[start + i];
+        }
+    }
+    return ret;
+}
+#endif
+
+#if defined(MICRORPC_ASYNC) || defined(MICRORPC_SCHEDULER)
+static int copyCommand(Command *dst, char *buf, int size, Command *src){
+    // @brief Copy a parsed command with the argument bytes it points into
+    // @desc: Each argument is copied on its own and packed into buf, so slices spread over two
+    // @desc: ring segments and a spill buffer copy too. The copy outlives the caller's message
+    // @return: 0 if successful, -1 if the arguments do not fit size bytes
+    int len = 0;
+    for(int i = 0; i < src->proto->numArgs; i++){
+        len += (src->args[i].buf != 0) ? src->args[i].len : 0;
+    }
+    if(len > size) return -1; // Arguments do not fit
+    *dst = *src;
+    int off = 0;
+    for(int i = 0; i < src->proto->numArgs; i++){
+        Message *arg = &src->args[i];
+        if(arg->buf == 0) continue;
+        for(int j = 0; j < arg->len; j++){
+            buf[off + j] = arg->buf[j];
+        }
+        dst->args[i].buf = buf + off;
+        off += arg->len;
+    }
+    return 0;
+}
+#endif
+
+#ifdef MICRORPC_ASYNC
+static int parkCommand(Command *cmd, Gateway *gateway, Response *response, int start){
+    // @brief Move a command whose service returned RPC_PENDING into a free gateway handle
+    // @desc: The argument bytes and the response written since start are copied, the caller's
+    // @desc: message and sink are free again once execCommand returns
+    // @return: RPC_PENDING if parked, -1 if no handle is free or the command does not fit one
+    Deferred *deferred = 0;
+    for(int i = 0; i < gateway->deferSize && deferred == 0; i++){
+        if(gateway->deferred[i].busy == 0) deferred = &gateway->deferred[i];
+    }
+    int len = response->len - start;
+    if(deferred == 0 || len > RPC_DEFER_TX_SIZE - 1 || copyCommand(&deferred->cmd, deferred->msg, MAX_CMD_SIZE, cmd) != 0){
+        response->len = start;
+        if(response->size > 0) response->buf[start] = '\0';
+        return -1; // No handle is free or the command does not fit
+    }
+    initResponse(&deferred->response, deferred->tx, RPC_DEFER_TX_SIZE);
+    writeResponse(&deferred->response, response->buf + start, len); // e.g. the correlation id
+    response->len = start; // Nothing to send until the command completes
+    if(response->size > 0) response->buf[start] = '\0';
+    deferred->poll = cmd->poll;
+    deferred->state = cmd->pollState;
+    deferred->tag = 0;
+    deferred->done = 0;
+    deferred->ret = 0;
+    deferred->busy = 1;
+    deferred->cmd.deferred = deferred;
+    cmd->deferred = deferred;
+    gateway->pending++;
+    return RPC_PENDING;
+}
+#endif
+
+#ifdef MICRORPC_MULTICAST
+static int castCommand(Command *cmd, Response *response, int onGateway){
+    // @brief Run a multicast command on every matching interface of its protocol offering the service
+    // @desc: Each member appends its id, the delimiter, its response and RPC_CAST_SEP, the
+    // @desc: correlation id leads the whole reply. onGateway is set by execCommand: each result goes
+    // @desc: to the member's Service.ret and, with MICRORPC_ASYNC, a member returning RPC_PENDING is
+    // @desc: parked in its own handle. Its record then leaves the reply and pollDeferred delivers it
+    // @note: Bypasses the response cache. Off the gateway a member's RPC_PENDING is not parked
+    // @return: Number of members run
+    Gateway *gateway = cmd->castGateway;
+    Interface *first = cmd->interface;
+    Service *service = cmd->service;
+    char sep = RPC_CAST_SEP;
+    int count = 0;
+    if(cmd->proto->seqIdx != 0){
+        putSequence(cmd, response);
+    }
+    for(int i = 0; i < gateway->count; i++){
+        Interface *member = gateway->interfaces[i];
+        int slot = (member->proto == cmd->proto && castMatch(cmd, member)) ? serviceSlot(member, service->key) : -1;
+        if(slot < 0) continue; // Not selected or does not offer the service
+        cmd->interface = member;
+        cmd->service = member->services[member->table[slot] - 1];
+#ifdef MICRORPC_ASYNC
+        int start = response->len; // Record of this member begins here
+#endif
+        putResponse(response, member->id);
+        writeResponse(response, &cmd->proto->delim, 1);
+        int ret = callService(cmd, response);
+        count++;
+#ifdef MICRORPC_ASYNC
+        if(ret == RPC_PENDING && onGateway){
+            ret = parkCommand(cmd, gateway, response, start); // The handle's response starts with the record
+            cmd->poll = 0;
+            cmd->pollState = 0;
+            if(ret == RPC_PENDING){
+                cmd->deferred->cmd.cast = CAST_NONE; // The handle completes this member only
+                cmd->deferred = 0;
+                continue;
+            }
+            putResponse(response, member->id); // No handle, the record reports the failure
+            writeResponse(response, &cmd->proto->delim, 1);
+        }
+#endif
+        if(onGateway) cmd->service->ret = ret;
+        writeResponse(response, &sep, 1);
+    }
+    cmd->interface = first; // Leave the command as updateCommand resolved it
+    cmd->service = service;
+    return count;
+}
+#endif
+
+int invokeService(Command *cmd, Response *response){
+    // @brief Run the service of a valid command and return its return value
+    // @desc: Does not touch the shared Service.ret, so it can run on any thread
+    // @desc: With a Protocol.seqIdx the response starts with the command's correlation id
+    // @desc: With MICRORPC_MULTICAST a multicast command runs on every selected interface, 0 is returned
+    // @note: Bypasses the gateway response cache, see execCommand
+#ifdef MICRORPC_MULTICAST
+    if(cmd->cast != CAST_NONE){
+        castCommand(cmd, response, 0);
+        return 0; // Member results are in the response
+    }
+#endif
+    if(cmd->proto->seqIdx != 0){
+        putSequence(cmd, response);
+    }
+    return callService(cmd, response);
+}
 
-    const int TARGET_IDX = 0;  
-    const int SERVICE_IDX =  1;
+int execCommand(Command *cmd, Gateway *gateway, Response *response){
+    // @brief Execute the command 
+    //  @desc: Execute the command by calling the service resolved by updateCommand
+    //  @desc: The service writes its response straight into the caller's sink, NULL discards it
+    //  @desc: With MICRORPC_CACHE idempotent services may be answered from the gateway cache
+    //  @desc: With MICRORPC_ASYNC a service returning RPC_PENDING leaves the sink empty, cmd->deferred
+    //  @desc: is its handle and the response is delivered by pollDeferred
+    //  @desc: With MICRORPC_MULTICAST a multicast command runs on every selected interface
+    //  @return: 0 if successful, RPC_PENDING if deferred, -1 if error
 
     if(cmd->valid == 0) return -1; // Command is not valid
-    Protocol *proto = cmd->proto; 
-    // Extract the target interface and service if from the command
-    char targetId[TARGET_ARG_LEN+1];
-    uCTrunk(targetId, cmd->proto->cmdFormat[TARGET_IDX].str.buf, 0,TARGET_ARG_LEN ); 
-    char serviceId[proto->cmdFormat[SERVICE_IDX].maxSize+1];  
-    uCTrunk(serviceId, cmd->proto->cmdFormat[SERVICE_IDX].str.buf, 0,proto->cmdFormat[SERVICE_IDX].str.len);
-
-    // Get the target interface from Gateway
-    Interface *interface = getInterface(gateway, targetId);
-    if(interface == 0){
-        return -1; // Interface does not exist
+    Service *service = cmd->service;
+    Response discard = {0};
+    if(response == 0){
+        response = &discard;
     }
-    // Get the target service from the interface
-    Service *service = getService(interface, serviceId);
-    if(service == 0){
-        return -1; // Service does not exist
+    int ret;
+#ifdef MICRORPC_ASYNC
+    int start = response->len; // Response of a deferred command begins here
+    cmd->poll = 0;
+    cmd->pollState = 0;
+    cmd->deferred = 0;
+#endif
+#ifdef MICRORPC_MULTICAST
+    if(cmd->cast != CAST_NONE){
+        castCommand(cmd, response, 1);
+        return 0; // Pending members are parked on their own, cmd->deferred stays 0
     }
+#endif
     // Execute the service function
-    service->ret = service->func(cmd,service->response,interface->data);
+#ifdef MICRORPC_CACHE
+    if(gateway->cache != 0 && service->idempotent){
+        if(cmd->proto->seqIdx != 0){
+            putSequence(cmd, response);
+        }
+        ret = cachedService(cmd, gateway, response);
+    }
+    else{
+        ret = invokeService(cmd, response);
+    }
+#else
+    ret = invokeService(cmd, response);
+#endif
+#ifdef MICRORPC_ASYNC
+    if(ret == RPC_PENDING){
+        return parkCommand(cmd, gateway, response, start);
+    }
+#endif
+    service->ret = ret;
 
     return 0;
 }
 
-int extractArg(char *arg, Protocol *proto, char *argId){
-    // @brief Extract an argument from the protocol
-    // @desc: Copy an argument from the protocol pointer by argument id
-    // Find the argument index
+int extractArg(char *arg, Command *cmd, char *argId){
+    // @brief Extract an argument from the command
+    // @desc: Copy an argument from the command slices by argument id
+    // Find the argument index by packed id
+    Protocol *proto = cmd->proto;
+    RPCId key = packId(argId, uCsize(argId) - 1);
     int argIdx = -1;
-    for(int i = 0; i < MAX_ARGS; i++){
-        if(uStrcmp(proto->cmdFormat[i].id, argId) == 0){
+    for(int i = 0; key != 0 && i < proto->numArgs; i++){
+        if(proto->cmdFormat[i].key == key){
             argIdx = i;
             break;
         }
@@ -280,23 +1412,11 @@ int extractArg(char *arg, Protocol *proto, char *argId){
         return -1; // Argument does not exist
     }
     // Copy the argument string by len
-    uCTrunk(arg,proto->cmdFormat[argIdx].str.buf, 0, proto->cmdFormat[argIdx].str.len);
+    uCTrunk(arg,cmd->args[argIdx].buf, 0, cmd->args[argIdx].len);
 
     return argIdx;
 }
 
-int getServiceResponse(Interface *interface, char *id, char *response){
-    // @brief Get the response of a service
-    // @desc: Copy the latests response of a service into the response buffer
-    Service *service = getService(interface, id);
-    if(service == 0){
-        return -1; // Service does not exist at this index 
-    }
-    uCcpy(response, service->response);
-    
-    return 0;
-}
-
 int getServiceRet(Interface *interface, char *id){
     // @brief Get the return value of a service
     Service *service = getService(interface, id);
@@ -306,8 +1426,452 @@ int getServiceRet(Interface *interface, char *id){
     return service->ret;
 }
 
+int splitResponse(Protocol *proto, Message *response, Message *seq, Message *payload){
+    // @brief Client side: split a pipelined response into its correlation id and the service output
+    // @desc: seq and payload point into the response, zero copy
+    // @return: 0 if successful, -1 if the response does not start with a correlation id
+    if(proto->seqIdx == 0) return -1; // Protocol is not pipelined
+    int off = 0; // Start of the correlation id
+    int len;
+    int skip = 0; // Bytes between the id and the payload
+    if(proto->mode == PROTO_TEXT){
+        len = uCscan(response->buf, 0, response->len, proto->delim, proto->delim);
+        if(len == response->len) return -1; // No delimiter
+        skip = 1;
+    }
+    else if(proto->mode == PROTO_FIXED){
+        len = proto->cmdFormat[proto->seqIdx].maxSize;
+    }
+    else{
+        if(response->len < 2 || (unsigned char)response->buf[0] != proto->seqIdx) return -1; // Not a seq record
+        off = 2;
+        len = (unsigned char)response->buf[1];
+    }
+    if(off + len + skip > response->len) return -1; // Truncated
+    seq->buf = response->buf + off;
+    seq->len = len;
+    payload->buf = response->buf + off + len + skip;
+    payload->len = response->len - off - len - skip;
+    return 0;
+}
+
+int getCommandRet(Command *cmd){
+    // @brief Get the return value of the service targeted by a command
+    if(cmd->service == 0){
+        return -1; // Command has no resolved service
+    }
+    return cmd->service->ret;
+}
+
+
+
+#ifdef MICRORPC_ASYNC
+// *** // **** Deferred Services **** // *** //
+int deferService(Command *cmd, rpcPoll poll, void *state){
+    // @brief Called by a service to complete later, return its result: return deferService(cmd, &step, &dev);
+    // @desc: pollDeferred calls poll(deferred, response, state) until it stops returning RPC_PENDING
+    // @desc: With poll 0 the command waits for completeDeferred on its handle, cmd->deferred
+    // @return: RPC_PENDING
+    cmd->poll = poll;
+    cmd->pollState = state;
+    return RPC_PENDING;
+}
+
+void completeDeferred(Deferred *deferred, int ret){
+    // @brief Complete a deferred command without a poll function, write deferred->response first
+    // @desc: Only sets a flag, pollDeferred delivers the command
+    deferred->ret = ret;
+    deferred->done = 1;
+}
+
+int pollDeferred(Gateway *gateway){
+    // @brief Step every pending command and deliver those that completed to the gateway's onDone
+    // @desc: The service's ret is set before onDone sees the command and its response, the handle
+    // @desc: is free again once onDone returns. A completed write drops the interface's cached responses
+    // @return: Number of commands still pending
+    for(int i = 0; i < gateway->deferSize; i++){
+        Deferred *deferred = &gateway->deferred[i];
+        if(deferred->busy == 0) continue;
+        if(deferred->done == 0 && deferred->poll != 0){
+            int ret = deferred->poll(deferred, &deferred->response, deferred->state);
+            if(ret != RPC_PENDING){
+                deferred->ret = ret;
+                deferred->done = 1;
+            }
+        }
+        if(deferred->done == 0) continue;
+        deferred->cmd.service->ret = deferred->ret;
+#ifdef MICRORPC_CACHE
+        if(deferred->cmd.service->idempotent == 0){
+            deferred->cmd.interface->version++; // The write landed, drop responses cached while it was pending
+        }
+#endif
+        if(gateway->onDone != 0){
+            gateway->onDone(deferred, gateway->doneCtx);
+        }
+        deferred->busy = 0;
+        gateway->pending--;
+    }
+    return gateway->pending;
+}
+#endif
+
+
+
+// *** // **** Streaming Parser **** // *** //
+void initParser(Parser *parser, Gateway *gateway, char term){
+    // @brief Initialize a streaming parser
+    // @desc: Frames are routed through the gateway and end with the term char
+    parser->gateway = gateway;
+    parser->term = term;
+    parser->len = 0;
+    parser->argLen = 0;
+    parser->argIdx = 0;
+    parser->discard = 0;
+}
+
+static RejectReason acceptByte(Parser *parser, Command *cmd, int i){
+    // @brief Account the frame byte at index i against the command's protocol
+    // @desc: Closes an argument on a delimiter and validates lengths as bytes arrive
+    // @return: REJECT_NONE if the byte is valid so far, else why the frame must be rejected
+    Protocol *proto = cmd->proto;
+    if(parser->buf[i] != proto->delim){
+        parser->argLen++;
+        if(parser->argIdx >= proto->numArgs) return REJECT_ARGS; // Too many arguments
+        if(parser->argLen >= proto->cmdFormat[parser->argIdx].maxSize) return REJECT_ARGS; // Argument is too long
+        return REJECT_NONE;
+    }
+    if(parser->argIdx >= proto->numArgs) return REJECT_ARGS; // Too many arguments
+    // Close the argument
+    cmd->args[parser->argIdx].buf = &parser->buf[i - parser->argLen];
+    cmd->args[parser->argIdx].len = parser->argLen;
+    if(decodeArg(cmd, parser->argIdx) != 0) return REJECT_ARGS; // Invalid value
+    if(parser->argIdx == SERVICE_IDX){
+        // Resolve the service as soon as its id is complete
+        cmd->service = resolveService(cmd, parser->gateway, cmd->args[SERVICE_IDX].buf, parser->argLen);
+        if(cmd->service == 0) return REJECT_SERVICE; // Service does not exist
+    }
+    parser->argLen = 0;
+    parser->argIdx++;
+    return REJECT_NONE;
+}
+
+static RejectReason endFrame(Parser *parser, Command *cmd){
+    // @brief Complete the current frame on its terminator
+    // @return: REJECT_NONE if the command is ready, else why the frame must be rejected
+    if(cmd->interface == 0) return REJECT_TARGET; // Target interface was never resolved
+    parser->buf[parser->len] = '\0';
+    if(parser->argIdx >= cmd->proto->numArgs) return REJECT_ARGS; // Too many arguments
+    // Close the last argument, the terminator acts as its delimiter
+    cmd->args[parser->argIdx].buf = &parser->buf[parser->len - parser->argLen];
+    cmd->args[parser->argIdx].len = parser->argLen;
+    if(decodeArg(cmd, parser->argIdx) != 0) return REJECT_ARGS; // Invalid value
+    if(parser->argIdx == SERVICE_IDX){
+        cmd->service = resolveService(cmd, parser->gateway, cmd->args[SERVICE_IDX].buf, parser->argLen);
+    }
+    if(cmd->service == 0) return REJECT_SERVICE; // Service does not exist
+    if(hasSequence(cmd) == 0) return REJECT_ARGS; // Correlation id is missing
+    return REJECT_NONE;
+}
+
+int feedParser(Parser *parser, Command *cmd, const char *data, int len, int *used){
+    // @brief Feed a chunk of bytes of any size to the parser
+    // @desc: Bytes are copied once into the parser and validated as they arrive
+    // @desc: Stops after the first frame that completes or is rejected, *used reports the bytes consumed
+    // @note: The ready command points into the parser and is valid until the next call
+    // @note: Only PROTO_TEXT interfaces can be streamed, binary frames are rejected
+    // @return: 1 if cmd is ready, 0 if more bytes are needed, -1 if a frame was rejected, cmd->reject tells why
+    int i = 0;
+    int ready = 0;
+    RejectReason reason = REJECT_NONE;
+    while(i < len && ready == 0 && reason == REJECT_NONE){
+        char c = data[i++];
+        if(parser->discard){
+            parser->discard = (c != parser->term); // Resume after the terminator
+            continue;
+        }
+        if(parser->len == 0){
+            clearCommand(cmd); // First byte of a new frame
+        }
+        if(c == parser->term){
+#ifdef MICRORPC_JOURNAL
+            if(parser->gateway->journal != 0){
+                // Journal the frame as the message updateCommand would see
+                Message frame = {.buf = parser->buf, .len = parser->len + 1};
+                parser->buf[parser->len] = '\0';
+                parser->gateway->journal(&frame, parser->gateway->journalCtx);
+            }
+#endif
+            reason = endFrame(parser, cmd);
+            ready = (reason == REJECT_NONE);
+            continue;
+        }
+        if(c == '\0'){
+            reason = REJECT_ARGS; // Invalid byte
+        }
+        else if(parser->len >= MAX_CMD_SIZE){
+            reason = REJECT_LENGTH; // Frame overflow
+        }
+        else{
+            parser->buf[parser->len++] = c;
+            if(cmd->interface == 0){
+                if(parser->len == TARGET_ARG_LEN){
+                    // Resolve the target interface, then account the bytes held so far
+                    cmd->interface = targetInterface(cmd, parser->gateway, parser->buf);
+                    if(cmd->interface == 0 || cmd->interface->proto->mode != PROTO_TEXT){
+                        reason = REJECT_TARGET; // Target interface does not exist or is not a text protocol
+                        cmd->interface = 0;
+                    }
+                    else{
+                        cmd->proto = cmd->interface->proto;
+                        for(int j = 0; j < parser->len && reason == REJECT_NONE; j++){
+                            reason = acceptByte(parser, cmd, j);
+                        }
+                    }
+                }
+            }
+            else{
+                reason = acceptByte(parser, cmd, parser->len - 1);
+            }
+            if(reason == REJECT_NONE && cmd->proto != 0 && parser->len + 1 > cmd->proto->maxCmdLen){
+                reason = REJECT_LENGTH; // msg is too long, the length includes the null terminator
+            }
+        }
+        if(reason != REJECT_NONE){
+            parser->discard = 1; // Skip the rest of the rejected frame
+        }
+    }
+    if(ready){
+        acceptCommand(cmd, parser->gateway, parser->len + 1);
+    }
+    else if(reason != REJECT_NONE){
+        rejectCommand(cmd, parser->gateway, reason);
+    }
+    if(ready || reason != REJECT_NONE){
+        // Frame complete or rejected, start the next frame
+        parser->len = 0;
+        parser->argLen = 0;
+        parser->argIdx = 0;
+    }
+    *used = i;
+    return ready ? 1 : (reason != REJECT_NONE ? -1 : 0);
+}
+
+
+
+// *** // **** Ring Buffers **** // *** //
+RingView ringView(char *ring, int size, int start, int len){
+    // @brief View len bytes of a circular buffer of size bytes starting at index start
+    RingView view;
+    int head = (len < size - start) ? len : size - start;
+    view.first.buf = &ring[start];
+    view.first.len = head;
+    view.second.buf = ring;
+    view.second.len = len - head;
+    return view;
+}
+
+static int ringScan(RingView *view, int start, char delim){
+    // @brief Find the next delimiter or '\0' of a ring view from index start
+    // @return: Index in the view, the view length if not found
+    if(start < view->first.len){
+        int i = uCscan(view->first.buf, start, view->first.len, delim, '\0');
+        if(i < view->first.len) return i;
+        start = view->first.len;
+    }
+    return view->first.len + uCscan(view->second.buf, start - view->first.len, view->second.len, delim, '\0');
+}
+
+static int ringSlice(RingView *view, int start, int len, char *spill, int spillSize, Message *arg){
+    // @brief Point arg at len bytes of the view, in place unless they straddle the wrap point
+    // @desc: Only a straddling slice is copied, into spill
+    // @return: 0 if successful, -1 if the straddling slice does not fit the spill buffer
+    int head = view->first.len;
+    arg->len = len;
+    if(start + len <= head){
+        arg->buf = &view->first.buf[start];
+        return 0;
+    }
+    if(start >= head){
+        arg->buf = &view->second.buf[start - head];
+        return 0;
+    }
+    if(len > spillSize) return -1; // Spill buffer is too small
+    for(int i = 0; i < len; i++){
+        spill[i] = (start + i < head) ? view->first.buf[start + i] : view->second.buf[start + i - head];
+    }
+    arg->buf = spill;
+    return 0;
+}
+
+int updateCommandRing(Command *cmd, RingView *view, Gateway *gateway, char *spill, int spillSize){
+    // @brief Update the command with one frame read straight from a circular receive buffer
+    // @desc: The view holds the frame without its terminator, the last argument ends with the view
+    // @desc: Arguments point into the ring, only the one straddling the wrap point is copied to spill
+    // @note: Text protocols only, the generic parser is used. Keep the ring bytes and spill until the command ran
+    // @return: 0 if successful, -1 if error, cmd->reject tells why
+    int len = view->first.len + view->second.len;
+#ifdef MICRORPC_JOURNAL
+    if(gateway->journal != 0 && len <= MAX_CMD_SIZE){
+        // Journal a linear copy of the frame as the message updateCommand would see
+        char frame[MAX_CMD_SIZE + 1];
+        Message msg = {.buf = frame, .len = len + 1};
+        for(int i = 0; i < len; i++){
+            frame[i] = (i < view->first.len) ? view->first.buf[i] : view->second.buf[i - view->first.len];
+        }
+        frame[len] = '\0';
+        gateway->journal(&msg, gateway->journalCtx);
+    }
+#endif
+    char target[TARGET_ARG_LEN];
+    Message id;
+    Interface *interface = 0;
+    if(len >= TARGET_ARG_LEN && ringSlice(view, 0, TARGET_ARG_LEN, target, TARGET_ARG_LEN, &id) == 0){
+        interface = targetInterface(cmd, gateway, id.buf);
+    }
+    if(bindCommand(cmd, gateway, interface, len + 1, len) != 0){
+        return -1; // Unknown target or msg is too long, the length includes a terminator
+    }
+    Protocol *proto = cmd->proto;
+    if(proto->mode != PROTO_TEXT){
+        return rejectCommand(cmd, gateway, REJECT_ARGS); // Binary frames are not parsed from rings
+    }
+    int start = 0;
+    int argIdx = 0;
+    for(;;){
+        if(argIdx == proto->numArgs) return rejectCommand(cmd, gateway, REJECT_ARGS); // Too many arguments
+        int i = ringScan(view, start, proto->delim);
+        if(i - start >= proto->cmdFormat[argIdx].maxSize) return rejectCommand(cmd, gateway, REJECT_ARGS); // Argument is too long
+        if(ringSlice(view, start, i - start, spill, spillSize, &cmd->args[argIdx]) != 0 || decodeArg(cmd, argIdx) != 0){
+            return rejectCommand(cmd, gateway, REJECT_ARGS); // Spill buffer is too small or invalid value
+        }
+        argIdx++;
+        if(i == len) break; // The view end closes the last argument
+        char c = (i < view->first.len) ? view->first.buf[i] : view->second.buf[i - view->first.len];
+        if(c == '\0') break; // So does a '\0'
+        start = i + 1;
+    }
+    return resolveCommand(cmd, gateway, len + 1);
+}
+
+
+
+// *** // **** Specialized Protocols **** // *** //
+// RPC_PROTOCOL declares a text Protocol fixed at build time together with a parser for
+// that exact layout: constant delimiter, one unrolled check per argument with its size
+// and type folded in, and no loop over cmdFormat. The Command it fills is the same as
+// the generic parser's. List the arguments as X(ID, maxSize, ArgType, scale) and
+// expand at file scope:
+//   #define SENSOR_ARGS(X) X(TRGT, 4, ARG_STR, 0) X(SRVC, 4, ARG_STR, 0) X(TEMP, 8, ARG_FIXED, 2)
+//   RPC_PROTOCOL(sensorProto, ',', 28, SENSOR_ARGS)
+//   createInterface(&sensors, "SNS", &sensorProto, NULL, &arena, 4);
+#define RPC_ARG_FORMAT(ID, SIZE, TYPE, SCALE) {.id = #ID, .maxSize = (SIZE), .type = (TYPE), .scale = (SCALE)},
+#define RPC_ARG_COUNT(ID, SIZE, TYPE, SCALE) + 1
+#define RPC_ARG_PARSE(ID, SIZE, TYPE, SCALE) \
+    if(start >= msgCmd->len) return 0; /* Missing arguments are tolerated */ \
+    end = uCscan(msgCmd->buf, start, msgCmd->len, delim, '\0'); \
+    if(end == msgCmd->len) return 0; /* Argument is not terminated */ \
+    if(end - start >= (SIZE)) return -1; /* Argument is too long */ \
+    cmd->args[argIdx].buf = &msgCmd->buf[start]; \
+    cmd->args[argIdx].len = end - start; \
+    if(decodeTextArg((TYPE), (SCALE), &cmd->args[argIdx], &cmd->argv[argIdx]) != 0) return -1; /* Invalid value */ \
+    argIdx++; \
+    start = end + 1;
+
+#define RPC_PROTOCOL(NAME, DELIM, MAX_LEN, ARGS) \
+    static CmdArg NAME##Format[] = { ARGS(RPC_ARG_FORMAT) }; \
+    static int NAME##Parse(Command *cmd, Message *msgCmd){ \
+        const char delim = (DELIM); \
+        int start = 0; \
+        int end; \
+        int argIdx = 0; \
+        ARGS(RPC_ARG_PARSE) \
+        if(start < msgCmd->len && uCscan(msgCmd->buf, start, msgCmd->len, delim, '\0') != msgCmd->len){ \
+            return -1; /* Too many arguments */ \
+        } \
+        return 0; \
+    } \
+    static Protocol NAME = { \
+        .numArgs = 0 ARGS(RPC_ARG_COUNT), \
+        .delim = (DELIM), \
+        .maxCmdLen = (MAX_LEN), \
+        .maxArgLen = (MAX_LEN), \
+        .cmdFormat = NAME##Format, \
+        .parse = &NAME##Parse \
+    };
+
+
+
+// *** // **** Metrics **** // *** //
+#ifdef MICRORPC_METRICS
+void snapshotGatewayStats(Gateway *gateway, GatewayStats *out){
+    // @brief Copy the parse counters of a gateway
+    *out = gateway->stats;
+}
+
+void snapshotInterfaceStats(Interface *interface, InterfaceStats *out){
+    // @brief Copy the throughput counters of an interface
+    *out = interface->stats;
+}
+
+void snapshotServiceStats(Service *service, ServiceStats *out){
+    // @brief Copy the call counters and latency histogram of a service
+    *out = service->stats;
+}
+
+void resetMetrics(Gateway *gateway){
+    // @brief Zero the counters of the gateway and every registered interface and service
+    GatewayStats gatewayZero = {0};
+    InterfaceStats interfaceZero = {0};
+    ServiceStats serviceZero = {0};
+    gateway->stats = gatewayZero;
+    for(int i = 0; i < gateway->count; i++){
+        Interface *interface = gateway->interfaces[i];
+        interface->stats = interfaceZero;
+        for(int j = 0; j < interface->count; j++){
+            interface->services[j]->stats = serviceZero;
+        }
+    }
+}
+
+static void putStat(Response *response, char sep, unsigned long value){
+    char num[21];
+    writeResponse(response, &sep, 1);
+    writeResponse(response, num, uCfromUint(num, value));
+}
 
+int metricsService(Command *cmd, Response *response, void *data){
+    // @brief Built in service reporting the metrics of a gateway
+    // @desc: Register it on an interface whose data is the Gateway* to export
+    // @desc: Format: acc=N rej=target,length,args,service then per interface
+    // @desc: " ID:commands:bytes" followed by " ID:calls:avgTicks:maxTicks" per service
+    // @return: 0 if the report fits the response, -1 if it was truncated
+    Gateway *gateway = data;
+    putResponse(response, "acc");
+    putStat(response, '=', gateway->stats.accepted);
+    putResponse(response, " rej");
+    for(int r = REJECT_TARGET; r < NUM_REJECT; r++){
+        putStat(response, (r == REJECT_TARGET) ? '=' : ',', gateway->stats.rejects[r]);
+    }
+    for(int i = 0; i < gateway->count; i++){
+        Interface *interface = gateway->interfaces[i];
+        putResponse(response, " ");
+        putResponse(response, interface->id);
+        putStat(response, ':', interface->stats.commands);
+        putStat(response, ':', interface->stats.bytes);
+        for(int j = 0; j < interface->count; j++){
+            ServiceStats *stats = &interface->services[j]->stats;
+            putResponse(response, " ");
+            putResponse(response, interface->services[j]->id);
+            putStat(response, ':', stats->calls);
+            putStat(response, ':', stats->calls ? stats->totalTicks / stats->calls : 0);
+            putStat(response, ':', stats->maxTicks);
+        }
+    }
+    return response->overflow ? -1 : 0;
+}
+#endif
 
-#endif 
 
 
+#endif
@@ -0,0 +1,227 @@
+#ifndef UCOMMANDER_EXECUTOR_H
+#define UCOMMANDER_EXECUTOR_H
+
+// *** // Executor // *** //
+// Runs parsed commands on a pool of worker threads (Linux/POSIX hosts).
+// Each worker owns a bounded lock-free MPSC queue: any number of receive/parse
+// threads submit without blocking, and only the owning worker dequeues.
+// Completion is reported through a callback on the worker thread and a done flag
+// that can be polled. Workers may block, so services run here should not defer:
+// RPC_PENDING is reported as the job's return value.
+// A multicast job runs all its members on one worker, also when queued by interface.
+
+
+// *** // Includes // *** //
+#include <pthread.h>
+#include <sched.h> // sched_yield
+#include <semaphore.h>
+#include <stdatomic.h>
+#include "microRPC.h"
+
+
+// *** // Static Array Allocation // *** //
+#define EXECUTOR_MAX_WORKERS 16
+#define EXECUTOR_QUEUE_SIZE 256 // Jobs per worker queue, must be a power of two
+
+
+// *** // Data Structures // *** //
+typedef struct RPCJob RPCJob;
+typedef void (*rpcDone)(RPCJob *job, void *ctx); // Completion callback, runs on the worker
+
+struct RPCJob{
+    Command cmd; // Copy of the submitted command, its message must outlive the job
+    Response response; // Sink of this execution, points at the caller's buffer
+    int ret; // Return value of this execution
+    atomic_int done; // Set once response and ret are written
+    rpcDone onDone;
+    void *ctx;
+}; // A command in flight, owned by the caller until done
+
+typedef struct JobSlot{
+    atomic_size_t seq; // Slot sequence, tells producers and the consumer whose turn it is
+    RPCJob *job;
+}JobSlot;
+
+typedef struct JobQueue{
+    JobSlot slots[EXECUTOR_QUEUE_SIZE];
+    atomic_size_t head; // Next position to claim, shared by producers
+    size_t tail; // Next position to read, owned by the worker
+    sem_t ready; // Counts published jobs, the worker sleeps on it
+}JobQueue; // Bounded multi producer single consumer queue
+
+typedef struct WorkerArg{
+    struct Executor *executor;
+    int idx; // Index of the worker's queue
+}WorkerArg;
+
+typedef struct Executor{
+    JobQueue queues[EXECUTOR_MAX_WORKERS];
+    pthread_t threads[EXECUTOR_MAX_WORKERS];
+    WorkerArg args[EXECUTOR_MAX_WORKERS];
+    int numWorkers;
+    int byInterface; // Route every command of an interface to the same worker
+    atomic_size_t next; // Round robin cursor
+    atomic_int stop;
+}Executor; // A pool of workers executing commands
+
+
+// *** // Internal functions // *** //
+static void initJobQueue(JobQueue *queue){
+    // @brief Initialize a queue with every slot free for its first lap
+    for(size_t i = 0; i < EXECUTOR_QUEUE_SIZE; i++){
+        atomic_init(&queue->slots[i].seq, i);
+        queue->slots[i].job = 0;
+    }
+    atomic_init(&queue->head, 0);
+    queue->tail = 0;
+    sem_init(&queue->ready, 0, 0);
+}
+
+static int pushJob(JobQueue *queue, RPCJob *job){
+    // @brief Publish a job, safe from any number of producer threads
+    // @return: 0 if successful, -1 if the queue is full
+    size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    JobSlot *slot;
+    for(;;){
+        slot = &queue->slots[pos & (EXECUTOR_QUEUE_SIZE - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        long diff = (long)seq - (long)pos;
+        if(diff == 0){
+            // Slot is free on this lap, claim the position
+            if(atomic_compare_exchange_weak_explicit(&queue->head, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed)){
+                break;
+            }
+        }
+        else if(diff < 0){
+            return -1; // Queue is full
+        }
+        else{
+            pos = atomic_load_explicit(&queue->head, memory_order_relaxed); // Lost the race
+        }
+    }
+    slot->job = job;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release); // Publish to the worker
+    sem_post(&queue->ready);
+    return 0;
+}
+
+static RPCJob *popJob(JobQueue *queue){
+    // @brief Take the oldest job, only called by the owning worker
+    // @desc: A producer claims its position before it publishes the slot, so the token of a later
+    // @desc: job may wake the worker first. Wait for the claimed head slot rather than drop the token.
+    // @return: Pointer to the job or 0 if the queue is empty
+    JobSlot *slot = &queue->slots[queue->tail & (EXECUTOR_QUEUE_SIZE - 1)];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    while(seq != queue->tail + 1){
+        if(atomic_load_explicit(&queue->head, memory_order_relaxed) == queue->tail){
+            return 0; // Nothing claimed, the queue is empty
+        }
+        sched_yield(); // Claimed but not published yet
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    }
+    RPCJob *job = slot->job;
+    atomic_store_explicit(&slot->seq, queue->tail + EXECUTOR_QUEUE_SIZE, memory_order_release); // Free for the next lap
+    queue->tail++;
+    return job;
+}
+
+static void runJob(RPCJob *job){
+    // @brief Execute a job's service into the job's own response
+    // @desc: With MICRORPC_METRICS, define MICRORPC_METRICS_ATOMIC as well since workers share the counters
+    Command *cmd = &job->cmd;
+    job->ret = invokeService(cmd, &job->response);
+    atomic_store_explicit(&job->done, 1, memory_order_release);
+    if(job->onDone != 0){
+        job->onDone(job, job->ctx);
+    }
+}
+
+static void *workerMain(void *arg){
+    // @brief Worker loop: sleep until a job is published, run it, exit once stopped and drained
+    Executor *executor = ((WorkerArg *)arg)->executor;
+    JobQueue *queue = &executor->queues[((WorkerArg *)arg)->idx];
+    for(;;){
+        sem_wait(&queue->ready);
+        RPCJob *job = popJob(queue);
+        if(job != 0){
+            runJob(job);
+        }
+        else if(atomic_load(&executor->stop)){
+            return 0; // Stop token and nothing left to run
+        }
+    }
+}
+
+
+// *** // **** User Exposed Functions **** // *** //
+int startExecutor(Executor *executor, int numWorkers, int byInterface){
+    // @brief Start a pool of numWorkers threads
+    // @desc: byInterface keeps every command of an interface on one worker, so services
+    // @desc: sharing Interface.data never run concurrently. Otherwise jobs are spread round robin.
+    // @return: 0 if successful, -1 if error
+    if(numWorkers < 1 || numWorkers > EXECUTOR_MAX_WORKERS) return -1;
+    executor->numWorkers = numWorkers;
+    executor->byInterface = byInterface;
+    atomic_init(&executor->next, 0);
+    atomic_init(&executor->stop, 0);
+    for(int i = 0; i < numWorkers; i++){
+        initJobQueue(&executor->queues[i]);
+        executor->args[i].executor = executor;
+        executor->args[i].idx = i;
+        if(pthread_create(&executor->threads[i], 0, &workerMain, &executor->args[i]) != 0){
+            executor->numWorkers = i;
+            return -1; // Thread creation failed
+        }
+    }
+    return 0;
+}
+
+int submitCommand(Executor *executor, RPCJob *job, Command *cmd, char *buf, int size, rpcDone onDone, void *ctx){
+    // @brief Queue a valid command for execution, never blocks
+    // @desc: The command is copied into the job, the message it points into must outlive the job
+    // @desc: The service writes its response into buf, which must also outlive the job
+    // @return: 0 if queued, -1 if the command is invalid or every queue is full
+    if(cmd->valid == 0) return -1; // Command is not valid
+    job->cmd = *cmd;
+    initResponse(&job->response, buf, size);
+    job->onDone = onDone;
+    job->ctx = ctx;
+    job->ret = 0;
+    atomic_store_explicit(&job->done, 0, memory_order_relaxed);
+    size_t first;
+    if(executor->byInterface){
+        first = ((size_t)cmd->interface / sizeof(Interface)) % executor->numWorkers;
+        return pushJob(&executor->queues[first], job);
+    }
+    first = atomic_fetch_add_explicit(&executor->next, 1, memory_order_relaxed);
+    for(int i = 0; i < executor->numWorkers; i++){
+        if(pushJob(&executor->queues[(first + i) % executor->numWorkers], job) == 0){
+            return 0;
+        }
+    }
+    return -1; // Every queue is full
+}
+
+int jobDone(RPCJob *job){
+    // @brief Poll a job
+    // @return: 1 once response and ret can be read, 0 if still in flight
+    return atomic_load_explicit(&job->done, memory_order_acquire);
+}
+
+void stopExecutor(Executor *executor){
+    // @brief Run every queued job, then stop and join the workers
+    atomic_store(&executor->stop, 1);
+    for(int i = 0; i < executor->numWorkers; i++){
+        sem_post(&executor->queues[i].ready); // Wake the worker to see the stop token
+    }
+    for(int i = 0; i < executor->numWorkers; i++){
+        pthread_join(executor->threads[i], 0);
+        sem_destroy(&executor->queues[i].ready);
+    }
+    executor->numWorkers = 0;
+}
+
+
+
+#endif
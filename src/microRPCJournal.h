@@ -0,0 +1,228 @@
+#ifndef UCOMMANDER_JOURNAL_H
+#define UCOMMANDER_JOURNAL_H
+
+// *** // Journal // *** //
+// Append only binary journal of the messages a Gateway receives (POSIX hosts), and an
+// offline replay that feeds a journal back through a Gateway to reproduce captured load.
+// Stream and ring frames rejected before they are complete are not recorded, see setJournal.
+// Include this header before microRPC.h, or define MICRORPC_JOURNAL for the whole build.
+// File layout: JOURNAL_MAGIC, then one record per message in native byte order:
+// [uint64 capture time in ns][uint32 len][len message bytes]
+
+
+// *** // Includes // *** //
+#ifndef MICRORPC_JOURNAL
+#define MICRORPC_JOURNAL
+#endif
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "microRPC.h"
+
+
+// *** // Static Array Allocation // *** //
+#define JOURNAL_MAGIC "uRPCJNL1" // 8 bytes, no terminator in the file
+#define JOURNAL_MAGIC_LEN 8
+#define JOURNAL_BUFFER_SIZE 65536 // stdio buffer, records reach the file in batches
+#define JOURNAL_MAX_MSG 4096 // Largest message replayed
+#define REPLAY_HIST_BUCKETS 64
+
+
+// *** // Data Structures // *** //
+typedef struct Journal{
+    FILE *file;
+    uint64_t records; // Records written since openJournal
+    int error; // Set once a write fails, the journal then stops recording
+}Journal; // Writer side, pass it as the ctx of journalMessage
+
+typedef struct JournalReader{
+    FILE *file;
+}JournalReader;
+
+typedef struct JournalRecord{
+    uint64_t ts; // Capture time in ns
+    Message msg; // Points into the caller's buffer
+}JournalRecord;
+
+typedef struct ReplayStats{
+    uint64_t messages; // Records replayed
+    uint64_t valid; // Records that parsed into a valid command
+    uint64_t bytes;
+    uint64_t elapsedNs; // Wall time of the whole replay
+    uint64_t totalNs; // Sum of per message latencies, parse and execute
+    uint64_t maxNs;
+    uint64_t hist[REPLAY_HIST_BUCKETS]; // Bucket i counts latencies in [2^(i-1), 2^i) ns
+}ReplayStats; // Throughput and latency of a replay
+
+
+// *** // Internal functions // *** //
+static uint64_t journalNow(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void journalSleepUntil(uint64_t ns){
+    // @brief Sleep until an absolute CLOCK_MONOTONIC time
+    struct timespec ts = {.tv_sec = (time_t)(ns / 1000000000ULL), .tv_nsec = (long)(ns % 1000000000ULL)};
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR){
+        // Interrupted by a signal, sleep the remainder
+    }
+}
+
+static int replayBucket(uint64_t ns){
+    int bucket = 0;
+    for(; ns != 0; ns >>= 1){
+        bucket++;
+    }
+    return (bucket < REPLAY_HIST_BUCKETS) ? bucket : REPLAY_HIST_BUCKETS - 1;
+}
+
+
+// *** // **** User Exposed Functions **** // *** //
+int openJournal(Journal *journal, const char *path){
+    // @brief Open a journal file for appending, a new file gets the magic header
+    // @return: 0 if successful, -1 if error
+    journal->records = 0;
+    journal->error = 0;
+    journal->file = fopen(path, "ab");
+    if(journal->file == 0) return -1;
+    setvbuf(journal->file, 0, _IOFBF, JOURNAL_BUFFER_SIZE);
+    fseek(journal->file, 0, SEEK_END);
+    if(ftell(journal->file) == 0 && fwrite(JOURNAL_MAGIC, 1, JOURNAL_MAGIC_LEN, journal->file) != JOURNAL_MAGIC_LEN){
+        fclose(journal->file);
+        journal->file = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void journalMessage(const Message *msg, void *ctx){
+    // @brief rpcJournal hook appending a message, register it with setJournal(gateway, &journalMessage, journal)
+    // @desc: Costs a clock read and a copy into the stdio buffer, no allocation
+    Journal *journal = ctx;
+    if(journal->error || msg->len < 0) return;
+    uint64_t ts = journalNow();
+    uint32_t len = (uint32_t)msg->len;
+    if(fwrite(&ts, sizeof(ts), 1, journal->file) != 1
+       || fwrite(&len, sizeof(len), 1, journal->file) != 1
+       || fwrite(msg->buf, 1, len, journal->file) != len){
+        journal->error = 1; // Disk full or closed, stop recording
+        return;
+    }
+    journal->records++;
+}
+
+int closeJournal(Journal *journal){
+    // @brief Flush and close a journal
+    // @return: 0 if every record reached the file, -1 if error
+    int ret = (journal->file == 0 || fclose(journal->file) != 0 || journal->error) ? -1 : 0;
+    journal->file = 0;
+    return ret;
+}
+
+int openJournalReader(JournalReader *reader, const char *path){
+    // @brief Open a journal for reading and check its header
+    // @return: 0 if successful, -1 if the file cannot be read or is not a journal
+    char magic[JOURNAL_MAGIC_LEN];
+    reader->file = fopen(path, "rb");
+    if(reader->file == 0) return -1;
+    int bad = fread(magic, 1, JOURNAL_MAGIC_LEN, reader->file) != JOURNAL_MAGIC_LEN;
+    for(int i = 0; i < JOURNAL_MAGIC_LEN && bad == 0; i++){
+        bad = (magic[i] != JOURNAL_MAGIC[i]);
+    }
+    if(bad){
+        fclose(reader->file);
+        reader->file = 0;
+        return -1;
+    }
+    return 0;
+}
+
+int readJournal(JournalReader *reader, JournalRecord *record, char *buf, int size){
+    // @brief Read the next record into buf, record->msg points at it
+    // @return: 1 if a record was read, 0 at the end of the journal, -1 if truncated or larger than size
+    uint32_t len;
+    if(fread(&record->ts, sizeof(record->ts), 1, reader->file) != 1) return 0;
+    if(fread(&len, sizeof(len), 1, reader->file) != 1) return -1;
+    if(len > (uint32_t)size || fread(buf, 1, len, reader->file) != len) return -1;
+    record->msg.buf = buf;
+    record->msg.len = (int)len;
+    return 1;
+}
+
+void closeJournalReader(JournalReader *reader){
+    if(reader->file != 0){
+        fclose(reader->file);
+    }
+    reader->file = 0;
+}
+
+int replayJournal(const char *path, Gateway *gateway, int realtime, ReplayStats *stats){
+    // @brief Feed every journaled message through updateCommand and execCommand
+    // @desc: As fast as possible, or with realtime set at the recorded spacing
+    // @desc: Latency covers parse and execute of one message, responses are discarded
+    // @note: The gateway's journal hook is suspended so the replay is not recorded again
+    // @return: 0 if the whole journal was replayed, -1 if it cannot be read or is corrupt
+    static char buf[JOURNAL_MAX_MSG + 1];
+    JournalReader reader;
+    JournalRecord record;
+    ReplayStats zero = {0};
+    *stats = zero;
+    if(openJournalReader(&reader, path) != 0) return -1;
+    rpcJournal hook = gateway->journal;
+    gateway->journal = 0;
+
+    Command cmd = {0};
+    char txBuf[256];
+    Response response;
+    uint64_t firstTs = 0;
+    uint64_t start = journalNow();
+    int ret;
+    while((ret = readJournal(&reader, &record, buf, JOURNAL_MAX_MSG)) == 1){
+        buf[record.msg.len] = '\0'; // Text parsing may scan up to a terminator
+        if(stats->messages == 0){
+            firstTs = record.ts;
+        }
+        if(realtime){
+            journalSleepUntil(start + (record.ts - firstTs));
+        }
+        uint64_t t0 = journalNow();
+        if(updateCommand(&cmd, &record.msg, gateway) == 0){
+            initResponse(&response, txBuf, sizeof(txBuf));
+            execCommand(&cmd, gateway, &response);
+            stats->valid++;
+        }
+        uint64_t ns = journalNow() - t0;
+        stats->messages++;
+        stats->bytes += (uint64_t)record.msg.len;
+        stats->totalNs += ns;
+        stats->hist[replayBucket(ns)]++;
+        if(ns > stats->maxNs){
+            stats->maxNs = ns;
+        }
+    }
+    stats->elapsedNs = journalNow() - start;
+    gateway->journal = hook;
+    closeJournalReader(&reader);
+    return (ret == 0) ? 0 : -1;
+}
+
+uint64_t replayPercentile(ReplayStats *stats, int percent){
+    // @brief Approximate latency percentile from the histogram
+    // @return: Upper bound in ns of the bucket holding the percentile, 0 if nothing was replayed
+    uint64_t rank = (stats->messages * (uint64_t)percent + 99) / 100;
+    uint64_t seen = 0;
+    for(int i = 0; i < REPLAY_HIST_BUCKETS; i++){
+        seen += stats->hist[i];
+        if(seen >= rank && seen != 0){
+            return (i == 0) ? 0 : ((uint64_t)1 << i) - 1;
+        }
+    }
+    return stats->maxNs;
+}
+
+
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef UCOMMANDER_SCHEDULER_H
+#define UCOMMANDER_SCHEDULER_H
+
+// *** // Scheduler // *** //
+// Queues parsed commands in front of execCommand and runs the most urgent first:
+// highest priority class, then earliest deadline, then arrival order. A command whose
+// deadline passed while it waited is dropped instead of executed. Priority and deadline
+// come from the Service, or per command from the Protocol's priorityIdx/deadlineIdx.
+// Deadlines are in RPC_NOW() ticks. No threads or heap, fits a main loop.
+// Include this header before microRPC.h, or define MICRORPC_SCHEDULER for the whole build.
+
+
+// *** // Includes // *** //
+#ifndef MICRORPC_SCHEDULER
+#define MICRORPC_SCHEDULER
+#endif
+#include "microRPC.h"
+
+
+// *** // Static Array Allocation // *** //
+#ifndef SCHED_CAPACITY
+#define SCHED_CAPACITY 16 // Queued commands, at most 255
+#endif
+
+
+// *** // Data Structures // *** //
+typedef struct SchedEntry{
+    Command cmd; // Copy of the command, its arguments point into msg
+    int priority;
+    unsigned long deadline; // Absolute RPC_NOW() time, 0 for none
+    unsigned long seq; // Arrival order
+    char msg[MAX_CMD_SIZE + 1];
+}SchedEntry; // A queued command
+
+typedef struct Scheduler{
+    Gateway *gateway;
+    SchedEntry entries[SCHED_CAPACITY];
+    unsigned char heap[SCHED_CAPACITY]; // Entry indices, most urgent at the root
+    unsigned char free[SCHED_CAPACITY]; // Stack of unused entry indices
+    int count; // Queued commands
+    int numFree;
+    unsigned long seq;
+    unsigned long expired; // Commands dropped because their deadline passed
+    unsigned long refused; // Commands not queued because the scheduler was full
+}Scheduler; // Priority and deadline queue of commands for one gateway
+
+
+// *** // Internal functions // *** //
+static int schedBefore(Scheduler *sched, int a, int b){
+    // @brief Check if entry a must run before entry b
+    SchedEntry *x = &sched->entries[a];
+    SchedEntry *y = &sched->entries[b];
+    if(x->priority != y->priority) return x->priority > y->priority;
+    if(x->deadline != y->deadline){
+        if(x->deadline == 0 || y->deadline == 0) return y->deadline == 0; // No deadline runs last
+        return (long)(x->deadline - y->deadline) < 0;
+    }
+    return (long)(x->seq - y->seq) < 0;
+}
+
+static void schedSwap(Scheduler *sched, int i, int j){
+    unsigned char tmp = sched->heap[i];
+    sched->heap[i] = sched->heap[j];
+    sched->heap[j] = tmp;
+}
+
+static void schedUp(Scheduler *sched, int i){
+    while(i > 0 && schedBefore(sched, sched->heap[i], sched->heap[(i - 1) / 2])){
+        schedSwap(sched, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void schedDown(Scheduler *sched, int i){
+    for(;;){
+        int best = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if(left < sched->count && schedBefore(sched, sched->heap[left], sched->heap[best])) best = left;
+        if(right < sched->count && schedBefore(sched, sched->heap[right], sched->heap[best])) best = right;
+        if(best == i) return;
+        schedSwap(sched, i, best);
+        i = best;
+    }
+}
+
+static int schedPop(Scheduler *sched){
+    // @brief Take the most urgent entry off the heap, its slot is free for the next scheduleCommand
+    int idx = sched->heap[0];
+    sched->count--;
+    sched->heap[0] = sched->heap[sched->count];
+    schedDown(sched, 0);
+    sched->free[sched->numFree++] = (unsigned char)idx;
+    return idx;
+}
+
+
+// *** // **** User Exposed Functions **** // *** //
+void initScheduler(Scheduler *sched, Gateway *gateway){
+    // @brief Initialize an empty scheduler running commands on gateway
+    sched->gateway = gateway;
+    sched->count = 0;
+    sched->numFree = SCHED_CAPACITY;
+    sched->seq = 0;
+    sched->expired = 0;
+    sched->refused = 0;
+    for(int i = 0; i < SCHED_CAPACITY; i++){
+        sched->free[i] = (unsigned char)(SCHED_CAPACITY - 1 - i);
+    }
+}
+
+int scheduleCommand(Scheduler *sched, Command *cmd){
+    // @brief Queue a valid command, copied so the caller's message can be reused
+    // @desc: The deadline counts from now, a protocol argument overrides the service's values
+    // @return: 0 if queued, -1 if the command is invalid, does not fit or the scheduler is full
+    if(cmd->valid == 0) return -1; // Command is not valid
+    if(sched->numFree == 0){
+        sched->refused++;
+        return -1; // Scheduler is full
+    }
+    int idx = sched->free[sched->numFree - 1];
+    SchedEntry *entry = &sched->entries[idx];
+    if(copyCommand(&entry->cmd, entry->msg, MAX_CMD_SIZE, cmd) != 0) return -1; // Command does not fit
+    Protocol *proto = cmd->proto;
+    entry->priority = cmd->service->priority;
+    unsigned long deadline = cmd->service->deadline;
+    if(proto->priorityIdx != 0 && cmd->args[proto->priorityIdx].len != 0){
+        entry->priority = (int)cmd->argv[proto->priorityIdx].i;
+    }
+    if(proto->deadlineIdx != 0 && cmd->args[proto->deadlineIdx].len != 0){
+        deadline = cmd->argv[proto->deadlineIdx].u;
+    }
+    entry->deadline = (deadline != 0) ? RPC_NOW() + deadline : 0;
+    if(deadline != 0 && entry->deadline == 0) entry->deadline = 1; // 0 means none
+    entry->seq = sched->seq++;
+    sched->numFree--;
+    sched->heap[sched->count] = (unsigned char)idx;
+    sched->count++;
+    schedUp(sched, sched->count - 1);
+    return 0;
+}
+
+Command *runNext(Scheduler *sched, Response *response){
+    // @brief Execute the most urgent queued command, dropping any whose deadline passed
+    // @desc: The response is written into the caller's sink as with execCommand, NULL discards it
+    // @return: The executed command, valid until the next scheduleCommand, or 0 if nothing is queued
+    while(sched->count > 0){
+        SchedEntry *entry = &sched->entries[schedPop(sched)];
+        if(entry->deadline != 0 && (long)(RPC_NOW() - entry->deadline) > 0){
+            sched->expired++; // Too late to be useful
+            continue;
+        }
+        execCommand(&entry->cmd, sched->gateway, response);
+        return &entry->cmd;
+    }
+    return 0;
+}
+
+
+
+#endif
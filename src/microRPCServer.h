@@ -0,0 +1,361 @@
+#ifndef UCOMMANDER_SERVER_H
+#define UCOMMANDER_SERVER_H
+
+// *** // Server // *** //
+// Reference transport for Linux hosts: non-blocking TCP and Unix domain sockets
+// multiplexed by epoll on one thread. Every connection owns a receive buffer, a
+// streaming Parser and a transmit buffer, taken from a caller supplied pool.
+// Frames end with the terminator and are routed through a Gateway, each command
+// is answered with its response followed by the terminator, rejected frames with
+// SERVER_REJECT, as are responses too large for the transmit buffer. A response
+// waits in its connection until the transmit buffer has room for it. When a
+// client stops reading, its connection stops being read until the transmit buffer
+// drains.
+
+
+// *** // Includes // *** //
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "microRPC.h"
+
+
+// *** // Static Array Allocation // *** //
+#define SERVER_RX_SIZE 1024 // Receive buffer per connection
+#define SERVER_TX_SIZE 1024 // Transmit buffer per connection
+#define SERVER_EVENTS 64 // Events handled per epoll_wait
+#define SERVER_MAX_LISTENERS 4
+#define SERVER_LISTENER_TAG 0x100000000ULL // epoll data of listeners, connections use their index
+#define SERVER_REJECT "ERR"
+
+
+// *** // Data Structures // *** //
+typedef struct Connection{
+    int fd; // -1 if the slot is free
+    Parser parser; // Frame being assembled
+    Command cmd; // Ready command, points into the parser
+    char rx[SERVER_RX_SIZE];
+    int rxLen; // Bytes received
+    int rxOff; // Bytes fed to the parser
+    char tx[SERVER_TX_SIZE];
+    int txLen; // Bytes queued
+    int txOff; // Bytes sent
+    char held[SERVER_TX_SIZE]; // Response of the last command, waiting for transmit space
+    int heldLen; // Bytes held including the terminator, 0 if none
+    int blocked; // Waiting for the client to read before parsing more
+    int nextFree;
+}Connection; // One client, owned by the server
+
+typedef struct Server{
+    Gateway *gateway;
+    int epfd;
+    int listeners[SERVER_MAX_LISTENERS];
+    int numListeners;
+    Connection *conns; // Caller supplied pool
+    int maxConns;
+    int freeHead; // First free connection, -1 if the pool is exhausted
+    int active; // Open connections
+    char term; // Frame terminator
+    unsigned long commands; // Commands executed
+    unsigned long rejected; // Frames rejected
+    unsigned long overflows; // Responses larger than the transmit buffer, answered with SERVER_REJECT
+    atomic_int stop;
+}Server; // Event loop routing socket traffic into a Gateway
+
+
+// *** // Internal functions // *** //
+static int setNonBlocking(int fd){
+    int flags = fcntl(fd, F_GETFL, 0);
+    if(flags < 0) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static int watchConnection(Server *server, int idx, unsigned int events, int op){
+    // @brief Add or change the epoll interest of a connection
+    struct epoll_event ev = {.events = events, .data.u64 = (uint64_t)idx};
+    return epoll_ctl(server->epfd, op, server->conns[idx].fd, &ev);
+}
+
+static void closeConnection(Server *server, int idx){
+    // @brief Close a client and return its slot to the pool
+    Connection *conn = &server->conns[idx];
+    epoll_ctl(server->epfd, EPOLL_CTL_DEL, conn->fd, 0);
+    close(conn->fd);
+    conn->fd = -1;
+    conn->nextFree = server->freeHead;
+    server->freeHead = idx;
+    server->active--;
+}
+
+static int addListener(Server *server, int fd){
+    // @brief Watch a bound listening socket for new clients
+    // @return: 0 if successful, -1 if error
+    if(server->numListeners >= SERVER_MAX_LISTENERS || listen(fd, SOMAXCONN) != 0 || setNonBlocking(fd) != 0){
+        close(fd);
+        return -1;
+    }
+    struct epoll_event ev = {.events = EPOLLIN, .data.u64 = SERVER_LISTENER_TAG + server->numListeners};
+    if(epoll_ctl(server->epfd, EPOLL_CTL_ADD, fd, &ev) != 0){
+        close(fd);
+        return -1;
+    }
+    server->listeners[server->numListeners++] = fd;
+    return 0;
+}
+
+static void acceptClients(Server *server, int listenFd){
+    // @brief Accept every pending client, refuse the ones the pool cannot hold
+    for(;;){
+        int fd = accept(listenFd, 0, 0);
+        if(fd < 0) return; // EAGAIN: no more pending clients
+        if(server->freeHead < 0 || setNonBlocking(fd) != 0){
+            close(fd); // Pool is exhausted
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Fails harmlessly on Unix sockets
+        int idx = server->freeHead;
+        Connection *conn = &server->conns[idx];
+        server->freeHead = conn->nextFree;
+        conn->fd = fd;
+        conn->rxLen = 0;
+        conn->rxOff = 0;
+        conn->txLen = 0;
+        conn->txOff = 0;
+        conn->heldLen = 0;
+        conn->blocked = 0;
+        initParser(&conn->parser, server->gateway, server->term);
+        if(watchConnection(server, idx, EPOLLIN, EPOLL_CTL_ADD) != 0){
+            close(fd);
+            conn->fd = -1;
+            conn->nextFree = server->freeHead;
+            server->freeHead = idx;
+            continue;
+        }
+        server->active++;
+    }
+}
+
+static int flushConnection(Connection *conn){
+    // @brief Send queued responses without blocking
+    // @return: 1 if everything was sent, 0 if the client is not reading, -1 if the connection failed
+    while(conn->txOff < conn->txLen){
+        ssize_t n = send(conn->fd, conn->tx + conn->txOff, conn->txLen - conn->txOff, MSG_NOSIGNAL);
+        if(n < 0){
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        conn->txOff += (int)n;
+    }
+    conn->txLen = 0;
+    conn->txOff = 0;
+    return 1;
+}
+
+static void queueResponse(Server *server, Connection *conn, int ready){
+    // @brief Execute a ready command or answer a rejected frame into the held response, the terminator ends it
+    // @desc: The held buffer takes any response the transmit buffer can, so the service runs whatever
+    // @desc: is queued. Only a response that could never be sent whole is replaced by SERVER_REJECT,
+    // @desc: the service is not run again
+    Response response;
+    initResponse(&response, conn->held, SERVER_TX_SIZE); // Leaves one byte for the terminator
+    if(ready){
+        execCommand(&conn->cmd, server->gateway, &response);
+        server->commands++;
+        if(response.overflow){
+            initResponse(&response, conn->held, SERVER_TX_SIZE);
+            putResponse(&response, SERVER_REJECT); // Never send a truncated response as complete
+            server->overflows++;
+        }
+    }
+    else{
+        putResponse(&response, SERVER_REJECT);
+        server->rejected++;
+    }
+    conn->held[response.len] = server->term;
+    conn->heldLen = response.len + 1;
+}
+
+static int placeResponse(Connection *conn){
+    // @brief Move the held response into the transmit buffer, flushing it to make room
+    // @return: 1 if moved, 0 if the client is not reading, -1 if the connection failed
+    while(SERVER_TX_SIZE - conn->txLen < conn->heldLen){
+        int sent = flushConnection(conn);
+        if(sent <= 0) return sent; // Once everything is sent the whole buffer is free, which fits any held response
+    }
+    for(int i = 0; i < conn->heldLen; i++){
+        conn->tx[conn->txLen + i] = conn->held[i];
+    }
+    conn->txLen += conn->heldLen;
+    conn->heldLen = 0;
+    return 1;
+}
+
+static int processConnection(Server *server, Connection *conn){
+    // @brief Parse the received bytes and queue a response per frame
+    // @desc: Stops early when a response waits for transmit space and the client is not reading
+    // @return: 0 if successful, -1 if the connection failed
+    for(;;){
+        if(conn->heldLen != 0){
+            int placed = placeResponse(conn);
+            if(placed < 0) return -1;
+            if(placed == 0){
+                conn->blocked = 1; // Resume once the client reads
+                return 0;
+            }
+        }
+        if(conn->rxOff >= conn->rxLen) break;
+        int used;
+        int ret = feedParser(&conn->parser, &conn->cmd, conn->rx + conn->rxOff, conn->rxLen - conn->rxOff, &used);
+        conn->rxOff += used;
+        if(ret != 0){
+            queueResponse(server, conn, ret == 1);
+        }
+    }
+    conn->blocked = 0;
+    conn->rxLen = 0;
+    conn->rxOff = 0;
+    return 0;
+}
+
+static void serveConnection(Server *server, int idx, unsigned int events){
+    // @brief Handle the readiness of one client
+    Connection *conn = &server->conns[idx];
+    if(events & (EPOLLERR | EPOLLHUP)){
+        closeConnection(server, idx);
+        return;
+    }
+    if(events & EPOLLIN){
+        ssize_t n = recv(conn->fd, conn->rx, SERVER_RX_SIZE, 0);
+        if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)){
+            closeConnection(server, idx); // Client closed or failed
+            return;
+        }
+        if(n > 0){
+            conn->rxLen = (int)n;
+            conn->rxOff = 0;
+        }
+    }
+    // Resumes the frames left by a blocked read once EPOLLOUT reports the client reads again
+    if(processConnection(server, conn) != 0 || flushConnection(conn) < 0){
+        closeConnection(server, idx);
+        return;
+    }
+    int pending = conn->blocked || conn->txOff < conn->txLen;
+    // Stop reading while responses wait, so a slow client cannot grow the backlog
+    if(watchConnection(server, idx, pending ? EPOLLOUT : EPOLLIN, EPOLL_CTL_MOD) != 0){
+        closeConnection(server, idx);
+    }
+}
+
+
+// *** // **** User Exposed Functions **** // *** //
+int initServer(Server *server, Gateway *gateway, Connection *conns, int maxConns, char term){
+    // @brief Create an event loop serving up to maxConns clients from the conns pool
+    // @return: 0 if successful, -1 if error
+    server->gateway = gateway;
+    server->conns = conns;
+    server->maxConns = maxConns;
+    server->numListeners = 0;
+    server->active = 0;
+    server->term = term;
+    server->commands = 0;
+    server->rejected = 0;
+    server->overflows = 0;
+    atomic_init(&server->stop, 0);
+    for(int i = 0; i < maxConns; i++){
+        conns[i].fd = -1;
+        conns[i].nextFree = (i + 1 < maxConns) ? i + 1 : -1;
+    }
+    server->freeHead = (maxConns > 0) ? 0 : -1;
+    server->epfd = epoll_create1(0);
+    return (server->epfd < 0) ? -1 : 0;
+}
+
+int listenTcp(Server *server, const char *ip, int port){
+    // @brief Accept TCP clients on ip:port, e.g. "127.0.0.1" or "0.0.0.0"
+    // @return: 0 if successful, -1 if error
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons((uint16_t)port)};
+    if(inet_pton(AF_INET, ip, &addr.sin_addr) != 1) return -1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0){
+        close(fd);
+        return -1;
+    }
+    return addListener(server, fd);
+}
+
+int listenUnix(Server *server, const char *path){
+    // @brief Accept clients on a Unix domain socket, an existing socket file is replaced
+    // @return: 0 if successful, -1 if error
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if(uCsize((char *)path) > (int)sizeof(addr.sun_path)) return -1; // Path is too long
+    uCcpy(addr.sun_path, (char *)path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) return -1;
+    unlink(path);
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0){
+        close(fd);
+        return -1;
+    }
+    return addListener(server, fd);
+}
+
+int pollServer(Server *server, int timeoutMs){
+    // @brief Wait up to timeoutMs for socket events and handle them
+    // @return: Number of events handled, -1 if epoll failed
+    struct epoll_event events[SERVER_EVENTS];
+    int n = epoll_wait(server->epfd, events, SERVER_EVENTS, timeoutMs);
+    if(n < 0) return (errno == EINTR) ? 0 : -1;
+    for(int i = 0; i < n; i++){
+        uint64_t tag = events[i].data.u64;
+        if(tag >= SERVER_LISTENER_TAG){
+            acceptClients(server, server->listeners[tag - SERVER_LISTENER_TAG]);
+        }
+        else if(server->conns[tag].fd >= 0){
+            serveConnection(server, (int)tag, events[i].events);
+        }
+    }
+    return n;
+}
+
+int runServer(Server *server){
+    // @brief Serve until stopServer is called, from another thread or a signal handler
+    // @return: 0 once stopped, -1 if epoll failed
+    while(atomic_load(&server->stop) == 0){
+        if(pollServer(server, 100) < 0) return -1;
+    }
+    return 0;
+}
+
+void stopServer(Server *server){
+    atomic_store(&server->stop, 1);
+}
+
+void closeServer(Server *server){
+    // @brief Close every client, listener and the epoll instance
+    for(int i = 0; i < server->maxConns; i++){
+        if(server->conns[i].fd >= 0){
+            closeConnection(server, i);
+        }
+    }
+    for(int i = 0; i < server->numListeners; i++){
+        close(server->listeners[i]);
+    }
+    server->numListeners = 0;
+    close(server->epfd);
+}
+
+
+
+#endif
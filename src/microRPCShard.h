@@ -0,0 +1,280 @@
+#ifndef UCOMMANDER_SHARD_H
+#define UCOMMANDER_SHARD_H
+
+// *** // Shards // *** //
+// Spreads interfaces over cores (Linux/POSIX hosts). Each shard owns a Gateway holding
+// a disjoint set of interfaces and a thread pinned to a core. One ingress thread routes
+// every message by its TRGT id into the owning shard's single producer single consumer
+// ring; the shard parses and executes it there. No mutable state is shared between
+// shards and the hot path takes no locks. With MICRORPC_MULTICAST a wildcard or group
+// target is copied to every shard holding a member, each shard answers for its own.
+
+
+// *** // Includes // *** //
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "microRPC.h"
+
+
+// *** // Static Array Allocation // *** //
+#define SHARD_MAX 16
+#define SHARD_RING_SIZE 1024 // Messages per ring, must be a power of two
+#define SHARD_MSG_SIZE 64 // Largest message a ring slot holds, including '\0'
+#define SHARD_TX_SIZE 64 // Response buffer of a shard
+#ifndef SHARD_ROUTE_SLOTS
+#define SHARD_ROUTE_SLOTS 64 // Hash slots of the interface route table, holds SHARD_ROUTE_SLOTS - 1 interfaces
+#endif
+#define SHARD_MAX_CPUS 1024
+#define SHARD_SPIN 1000 // Empty polls before an idle shard sleeps
+#define SHARD_IDLE_NS 50000
+
+
+// *** // Data Structures // *** //
+typedef struct Shard Shard;
+typedef void (*shardDone)(Shard *shard, Command *cmd, Response *response, void *ctx); // Runs on the shard
+
+typedef struct ShardSlot{
+    int len;
+    char buf[SHARD_MSG_SIZE];
+}ShardSlot;
+
+typedef struct ShardRing{
+    ShardSlot slots[SHARD_RING_SIZE];
+    _Alignas(64) atomic_size_t head; // Next slot to write, owned by the ingress thread
+    _Alignas(64) atomic_size_t tail; // Next slot to read, owned by the shard
+}ShardRing; // Single producer single consumer ring of message copies
+
+struct Shard{
+    ShardRing ring;
+    Gateway *gateway; // Only touched by this shard's thread once started
+    int cpu; // Core the thread is pinned to, -1 if not pinned
+    shardDone onDone; // 0 if responses are discarded
+    void *ctx;
+    char tx[SHARD_TX_SIZE];
+    unsigned long processed; // Messages taken from the ring, written by the shard only
+    unsigned long dropped; // Messages refused because the ring was full, written by the router only
+    pthread_t thread;
+    struct ShardSet *set;
+};
+
+typedef struct ShardRoute{
+    RPCId key; // Packed interface id
+    int shard; // Index + 1, 0 if the slot is empty
+}ShardRoute;
+
+typedef struct ShardSet{
+    Shard shards[SHARD_MAX];
+    int numShards;
+    ShardRoute routes[SHARD_ROUTE_SLOTS]; // Interface id -> shard, read only once started
+    int numRoutes; // Used route slots, one always stays empty so a probe ends
+    unsigned long unrouted; // Messages without a known target, written by the router only
+    atomic_int stop;
+}ShardSet; // Shards fed by one ingress thread
+
+
+// *** // Internal functions // *** //
+static int routeSlot(ShardSet *set, RPCId key){
+    // @brief Find the route slot of a packed interface id using linear probing
+    // @return: Slot holding the id, or -(free slot + 1) if the id is not in the table
+    int slot = idSlot(key, SHARD_ROUTE_SLOTS);
+    while(set->routes[slot].shard != 0){
+        if(set->routes[slot].key == key){
+            return slot; // Id found
+        }
+        slot = (slot + 1) % SHARD_ROUTE_SLOTS;
+    }
+    return -(slot + 1); // Id is not in the table
+}
+
+static int ringFull(Shard *shard){
+    // @brief Check if the shard's ring has no free slot, called by the router
+    ShardRing *ring = &shard->ring;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    return head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= SHARD_RING_SIZE;
+}
+
+static void pushMessage(Shard *shard, const char *buf, int len){
+    // @brief Copy a message into the shard's ring and publish it, the router checked for room
+    ShardRing *ring = &shard->ring;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ShardSlot *dst = &ring->slots[head & (SHARD_RING_SIZE - 1)];
+    for(int i = 0; i < len; i++){
+        dst->buf[i] = buf[i];
+    }
+    dst->buf[len] = '\0'; // Text parsing may scan up to a terminator
+    dst->len = len;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release); // Publish to the shard
+}
+
+#ifdef MICRORPC_MULTICAST
+static int routeCast(ShardSet *set, const char *buf, int len){
+    // @brief Copy a multicast message into the ring of every shard whose gateway holds a member
+    // @desc: Only reads the interface ids, groups and protocols of the gateways, none change once started
+    // @desc: All or nothing, if one of those rings is full no shard gets the message
+    // @return: Index of the first shard, or -1 if no shard holds a member or a ring is full
+    uint8_t members[SHARD_MAX];
+    int first = -1;
+    for(int i = 0; i < set->numShards; i++){
+        Command probe = {0};
+        members[i] = findCast(&probe, set->shards[i].gateway, buf) != 0;
+        if(members[i] == 0) continue;
+        if(ringFull(&set->shards[i])){
+            set->shards[i].dropped++;
+            return -1; // Ring is full
+        }
+        if(first < 0) first = i;
+    }
+    if(first < 0){
+        set->unrouted++;
+        return -1; // Target selects no interface
+    }
+    for(int i = first; i < set->numShards; i++){
+        if(members[i]) pushMessage(&set->shards[i], buf, len);
+    }
+    return first;
+}
+#endif
+
+static void pinThread(int cpu){
+    // @brief Pin the calling thread to a core, ignored if the core does not exist
+    unsigned long mask[SHARD_MAX_CPUS / (8 * sizeof(unsigned long))] = {0};
+    if(cpu < 0 || cpu >= SHARD_MAX_CPUS) return;
+    mask[cpu / (8 * sizeof(unsigned long))] = 1UL << (cpu % (8 * sizeof(unsigned long)));
+    syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask);
+}
+
+static void *shardMain(void *arg){
+    // @brief Shard loop: parse and execute messages in place in the ring, exit once stopped and drained
+    Shard *shard = arg;
+    ShardRing *ring = &shard->ring;
+    Command cmd = {0};
+    Response response;
+    int idle = 0;
+    pinThread(shard->cpu);
+    for(;;){
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        if(tail == atomic_load_explicit(&ring->head, memory_order_acquire)){
+            if(atomic_load(&shard->set->stop)) return 0; // Stop token and nothing left to run
+            if(++idle > SHARD_SPIN){
+                struct timespec ts = {.tv_sec = 0, .tv_nsec = SHARD_IDLE_NS};
+                nanosleep(&ts, 0);
+            }
+            continue;
+        }
+        idle = 0;
+        ShardSlot *slot = &ring->slots[tail & (SHARD_RING_SIZE - 1)];
+        Message msg = {.buf = slot->buf, .len = slot->len};
+        initResponse(&response, shard->tx, SHARD_TX_SIZE);
+        if(updateCommand(&cmd, &msg, shard->gateway) == 0){
+            execCommand(&cmd, shard->gateway, &response);
+        }
+        if(shard->onDone != 0){
+            shard->onDone(shard, &cmd, &response, shard->ctx);
+        }
+        shard->processed++;
+        atomic_store_explicit(&ring->tail, tail + 1, memory_order_release); // Slot is free for the router
+    }
+}
+
+
+// *** // **** User Exposed Functions **** // *** //
+void initShards(ShardSet *set){
+    // @brief Initialize an empty set of shards
+    set->numShards = 0;
+    set->numRoutes = 0;
+    set->unrouted = 0;
+    atomic_init(&set->stop, 0);
+    for(int i = 0; i < SHARD_ROUTE_SLOTS; i++){
+        set->routes[i].shard = 0; // Mark all route slots empty
+    }
+}
+
+int addShard(ShardSet *set, Gateway *gateway, int cpu, shardDone onDone, void *ctx){
+    // @brief Add a shard serving every interface of its gateway, pinned to cpu (-1 for any)
+    // @desc: Interfaces must not be shared between shard gateways, the set routes each id to one shard
+    // @note: Call before startShards
+    // @return: Index of the shard, or -1 if the set or the route table is full or an interface id is already routed
+    // @note: A refused shard leaves no routes behind
+    if(set->numShards >= SHARD_MAX) return -1;
+    if(set->numRoutes + gateway->count >= SHARD_ROUTE_SLOTS) return -1; // Route table is full
+    for(int i = 0; i < gateway->count; i++){
+        if(routeSlot(set, gateway->interfaces[i]->key) >= 0) return -1; // Interface id already routed
+    }
+    int idx = set->numShards;
+    for(int i = 0; i < gateway->count; i++){
+        RPCId key = gateway->interfaces[i]->key;
+        int slot = routeSlot(set, key);
+        set->routes[-slot - 1].key = key;
+        set->routes[-slot - 1].shard = idx + 1;
+    }
+    set->numRoutes += gateway->count;
+    Shard *shard = &set->shards[idx];
+    atomic_init(&shard->ring.head, 0);
+    atomic_init(&shard->ring.tail, 0);
+    shard->gateway = gateway;
+    shard->cpu = cpu;
+    shard->onDone = onDone;
+    shard->ctx = ctx;
+    shard->processed = 0;
+    shard->dropped = 0;
+    shard->set = set;
+    set->numShards++;
+    return idx;
+}
+
+int startShards(ShardSet *set){
+    // @brief Start one thread per shard
+    // @return: 0 if successful, -1 if a thread cannot be created
+    for(int i = 0; i < set->numShards; i++){
+        if(pthread_create(&set->shards[i].thread, 0, &shardMain, &set->shards[i]) != 0){
+            set->numShards = i;
+            return -1; // Thread creation failed
+        }
+    }
+    return 0;
+}
+
+int routeMessage(ShardSet *set, const char *buf, int len){
+    // @brief Copy a message into the ring of the shard owning its target interface
+    // @desc: Only one thread may route into a set, the rings have a single producer
+    // @desc: len counts the message bytes, text messages may include their '\0'
+    // @desc: With MICRORPC_MULTICAST a target that is not routed may select interfaces of several shards, see routeCast
+    // @return: Index of the shard, or -1 if the target is unknown, the message too long or the ring full
+    if(len < TARGET_ARG_LEN || len > SHARD_MSG_SIZE - 1){
+        set->unrouted++;
+        return -1; // Cannot hold a target id or does not fit a slot
+    }
+    RPCId key = packId(buf, TARGET_ARG_LEN);
+    int slot = (key != 0) ? routeSlot(set, key) : -1;
+#ifdef MICRORPC_MULTICAST
+    if(slot < 0 && key != 0){
+        return routeCast(set, buf, len);
+    }
+#endif
+    if(slot < 0){
+        set->unrouted++;
+        return -1; // Target interface does not exist
+    }
+    Shard *shard = &set->shards[set->routes[slot].shard - 1];
+    if(ringFull(shard)){
+        shard->dropped++;
+        return -1; // Ring is full
+    }
+    pushMessage(shard, buf, len);
+    return set->routes[slot].shard - 1;
+}
+
+void stopShards(ShardSet *set){
+    // @brief Run every queued message, then stop and join the shards
+    atomic_store(&set->stop, 1);
+    for(int i = 0; i < set->numShards; i++){
+        pthread_join(set->shards[i].thread, 0);
+    }
+}
+
+
+
+#endif
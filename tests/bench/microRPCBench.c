@@ -0,0 +1,227 @@
+#define MAX_MSG 512
+#define MAX_CMD_SIZE (MAX_MSG - 1) // Long messages are swept, raise the header's limit
+#include "../../src/microRPC.h"
+
+#include <stdio.h>  // printf & fopen
+#include <stdlib.h> // qsort
+#include <time.h>   // clock_gettime
+
+// *** MICRO RPC BENCHMARKS *** //
+// Measures updateCommand (generic and RPC_PROTOCOL generated), feedParser, execCommand, extractArg
+// and lookup throughput and latency percentiles while sweeping message length, argument, interface
+// and service counts.
+// Each dimension is swept around a baseline configuration, one at a time.
+// Usage: microRPC_bench [output.csv]   (CSV is written to stdout by default)
+
+#define BATCH 64 // Calls timed together, latency percentiles are per call within a batch
+#define SAMPLES 2000 // Batches per measurement
+#define BENCH_INTERFACES 8 // Largest interface count swept
+#define BENCH_SERVICES 32 // Largest service count swept, per interface
+
+typedef struct BenchConfig{
+    int argWidth; // Chars per payload argument
+    int numArgs; 
+    int numInterfaces; 
+    int numServices; // Per interface
+}BenchConfig;
+
+typedef struct BenchEnv{
+    unsigned char mem[(BENCH_INTERFACES + 1) * RPC_TABLE_BYTES(BENCH_SERVICES)];
+    RPCArena arena; // Tables sized to the swept counts
+    Gateway gateway;
+    Protocol proto;
+    CmdArg format[MAX_ARGS];
+    Interface interfaces[BENCH_INTERFACES];
+    Service services[BENCH_INTERFACES][BENCH_SERVICES];
+    char msg[MAX_MSG];
+    Message message;
+    char frame[MAX_MSG]; // msg with a stream terminator
+    int frameLen;
+}BenchEnv;
+
+// Baseline layout (4 args, 4 char payload) with a parser generated by RPC_PROTOCOL
+#define BENCH_GEN_ARGS(X) X(A00, 5, ARG_STR, 0) X(A01, 5, ARG_STR, 0) X(A02, 5, ARG_STR, 0) X(A03, 5, ARG_STR, 0)
+RPC_PROTOCOL(benchGenProto, ',', MAX_MSG - 1, BENCH_GEN_ARGS)
+
+static volatile int sink; // Keeps results observable to the compiler
+
+static int benchService(Command *cmd, Response *response, void *data){
+    writeResponse(response, "K", 1);
+    return cmd->args[0].len;
+}
+
+static double nowNs(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void makeId(char *id, char prefix, int n){
+    // Write a 3 char id such as "S07"
+    id[0] = prefix;
+    id[1] = '0' + (n / 10) % 10;
+    id[2] = '0' + n % 10;
+    id[3] = '\0';
+}
+
+static void setupEnv(BenchEnv *env, BenchConfig *cfg){
+    // Build a gateway and a message targeting the last registered interface and service
+    initArena(&env->arena, env->mem, sizeof(env->mem));
+    initRPC(&env->gateway, &env->arena, cfg->numInterfaces);
+    Protocol *proto = &env->proto;
+    proto->cmdFormat = env->format;
+    proto->numArgs = cfg->numArgs;
+    proto->delim = ',';
+    proto->maxArgLen = cfg->argWidth + 1;
+    proto->maxCmdLen = MAX_MSG - 1;
+    for(int a = 0; a < cfg->numArgs; a++){
+        makeId(proto->cmdFormat[a].id, 'A', a);
+        proto->cmdFormat[a].maxSize = (a <= SERVICE_IDX) ? MAX_ID_SIZE : cfg->argWidth + 1;
+    }
+    for(int i = 0; i < cfg->numInterfaces; i++){
+        char id[MAX_ID_SIZE];
+        makeId(id, 'I', i);
+        createInterface(&env->interfaces[i], id, proto, NULL, &env->arena, cfg->numServices);
+        addInterface(&env->gateway, &env->interfaces[i]);
+        for(int s = 0; s < cfg->numServices; s++){
+            Service *service = &env->services[i][s];
+            makeId(service->id, 'S', s);
+            service->func = &benchService;
+            registerService(&env->interfaces[i], service);
+        }
+    }
+    int len = snprintf(env->msg, MAX_MSG, "I%02d,S%02d", cfg->numInterfaces - 1, cfg->numServices - 1);
+    for(int a = 2; a < cfg->numArgs; a++){
+        env->msg[len++] = ',';
+        for(int c = 0; c < cfg->argWidth; c++){
+            env->msg[len++] = '0' + (c % 10);
+        }
+    }
+    env->msg[len] = '\0';
+    env->message.buf = env->msg;
+    env->message.len = len + 1; // Including null terminator
+    uCcpy(env->frame, env->msg);
+    env->frame[len] = '\n';
+    env->frameLen = len + 1;
+}
+
+static int cmpDouble(const void *a, const void *b){
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef enum {BENCH_PARSE, BENCH_PARSE_GEN, BENCH_STREAM, BENCH_EXEC, BENCH_EXTRACT, BENCH_LOOKUP, NUM_BENCH} BenchKind;
+static const char *benchNames[NUM_BENCH] = {"updateCommand", "updateCommandGen", "feedParser", "execCommand", "extractArg", "lookup"};
+
+static void runBench(FILE *out, BenchEnv *env, BenchConfig *cfg, BenchKind kind){
+    static double samples[SAMPLES];
+    Command cmd = {0};
+    Parser parser;
+    initParser(&parser, &env->gateway, '\n');
+    if(updateCommand(&cmd, &env->message, &env->gateway) != 0 || cmd.valid == 0){
+        fprintf(stderr, "bench: invalid message %s\n", env->msg);
+        return;
+    }
+    if(kind == BENCH_STREAM && env->frameLen > MAX_CMD_SIZE){
+        return; // Frame does not fit the streaming parser buffer
+    }
+    if(kind == BENCH_PARSE_GEN){
+        if(cfg->numArgs != benchGenProto.numArgs || cfg->argWidth != 4) return; // Generated for the baseline only
+        env->proto.parse = benchGenProto.parse;
+    }
+    char arg[MAX_MSG];
+    char txBuf[16];
+    Response response;
+    char *lastArg = env->proto.cmdFormat[cfg->numArgs - 1].id;
+    Message *target = &cmd.args[TARGET_IDX];
+    Message *service = &cmd.args[SERVICE_IDX];
+
+    double total = 0;
+    for(int s = 0; s < SAMPLES; s++){
+        int acc = 0;
+        double start = nowNs();
+        for(int b = 0; b < BATCH; b++){
+            switch(kind){
+            case BENCH_PARSE:
+            case BENCH_PARSE_GEN:
+                acc += updateCommand(&cmd, &env->message, &env->gateway);
+                break;
+            case BENCH_STREAM: {
+                int used;
+                acc += feedParser(&parser, &cmd, env->frame, env->frameLen, &used);
+                break;
+            }
+            case BENCH_EXEC:
+                initResponse(&response, txBuf, sizeof(txBuf));
+                acc += execCommand(&cmd, &env->gateway, &response);
+                break;
+            case BENCH_EXTRACT:
+                acc += extractArg(arg, &cmd, lastArg);
+                break;
+            case BENCH_LOOKUP: {
+                Interface *interface = lookupInterface(&env->gateway, target->buf, target->len);
+                acc += (lookupService(interface, service->buf, service->len) != 0);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        double elapsed = nowNs() - start;
+        sink += acc;
+        samples[s] = elapsed / BATCH;
+        total += elapsed;
+    }
+    env->proto.parse = 0;
+    qsort(samples, SAMPLES, sizeof(double), &cmpDouble);
+    fprintf(out, "%s,%d,%d,%d,%d,%.0f,%.1f,%.1f,%.1f\n", benchNames[kind], env->message.len - 1,
+            cfg->numArgs, cfg->numInterfaces, cfg->numServices,
+            (double)SAMPLES * BATCH / (total / 1e9),
+            samples[SAMPLES / 2], samples[SAMPLES * 90 / 100], samples[SAMPLES * 99 / 100]);
+}
+
+static void runConfig(FILE *out, BenchConfig *cfg){
+    static BenchEnv env;
+    setupEnv(&env, cfg);
+    for(int kind = 0; kind < NUM_BENCH; kind++){
+        runBench(out, &env, cfg, kind);
+    }
+}
+
+int main(int argc, char **argv){
+    FILE *out = stdout;
+    if(argc > 1){
+        out = fopen(argv[1], "w");
+        if(out == 0){
+            fprintf(stderr, "bench: cannot open %s\n", argv[1]);
+            return 1;
+        }
+    }
+    fprintf(out, "bench,msg_len,num_args,num_interfaces,num_services,ops_per_sec,p50_ns,p90_ns,p99_ns\n");
+
+    const BenchConfig base = {.argWidth = 4, .numArgs = 4, .numInterfaces = 1, .numServices = 1};
+    const int widths[] = {1, 4, 16, 64, 120};
+    for(int i = 0; i < (int)(sizeof(widths) / sizeof(widths[0])); i++){
+        BenchConfig cfg = base;
+        cfg.argWidth = widths[i];
+        runConfig(out, &cfg);
+    }
+    for(int n = 2; n <= MAX_ARGS; n++){
+        BenchConfig cfg = base;
+        cfg.numArgs = n;
+        runConfig(out, &cfg);
+    }
+    for(int n = 1; n <= BENCH_INTERFACES; n++){
+        BenchConfig cfg = base;
+        cfg.numInterfaces = n;
+        runConfig(out, &cfg);
+    }
+    for(int n = 1; n <= BENCH_SERVICES; n *= 2){
+        BenchConfig cfg = base;
+        cfg.numServices = n;
+        runConfig(out, &cfg);
+    }
+    if(out != stdout) fclose(out);
+    return 0;
+}
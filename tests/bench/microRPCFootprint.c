@@ -0,0 +1,73 @@
+#ifndef FOOTPRINT_SERVICES
+#define FOOTPRINT_SERVICES 4 // Services registered on the one interface
+#endif
+#include "../../src/microRPC.h"
+
+#include <stdio.h> // printf
+
+// *** MICRO RPC FOOTPRINT *** //
+// Smallest useful build: one statically allocated gateway, interface and FOOTPRINT_SERVICES services
+// that parses and executes one message. Prints the size of every structure for the configured limits;
+// the footprint target adds the text (flash) and data + bss (RAM) of the whole image.
+// Usage: cmake -DFOOTPRINT_DEFS="MAX_ARGS=4;MAX_CMD_SIZE=32" ... && cmake --build . --target footprint
+
+static unsigned char mem[RPC_TABLE_BYTES(1) + RPC_TABLE_BYTES(FOOTPRINT_SERVICES)];
+static RPCArena arena;
+static Gateway gateway;
+static Interface interface;
+static Service services[FOOTPRINT_SERVICES];
+static CmdArg format[] = {
+    {.id = "TRGT", .maxSize = 4},
+    {.id = "SRVC", .maxSize = 4},
+    {.id = "DATA", .maxSize = 8}
+};
+static Protocol proto = {
+    .numArgs = 3,
+    .maxCmdLen = MAX_CMD_SIZE,
+    .maxArgLen = 8,
+    .delim = ',',
+    .cmdFormat = format
+};
+
+static int okService(Command *cmd, Response *response, void *data){
+    putResponse(response, "OK");
+    return 0;
+}
+
+int main(void){
+    initArena(&arena, mem, sizeof(mem));
+    initRPC(&gateway, &arena, 1);
+    createInterface(&interface, "IF1", &proto, NULL, &arena, FOOTPRINT_SERVICES);
+    addInterface(&gateway, &interface);
+    for(int i = 0; i < FOOTPRINT_SERVICES; i++){
+        services[i].id[0] = 'S';
+        services[i].id[1] = '0' + i % 10;
+        services[i].id[2] = '\0';
+        services[i].func = &okService;
+        registerService(&interface, &services[i]);
+    }
+    char msg[] = "IF1,S0,DATA";
+    char tx[8];
+    Message message = {.buf = msg, .len = sizeof(msg)};
+    Command cmd = {0};
+    Response response;
+    initResponse(&response, tx, sizeof(tx));
+    if(updateCommand(&cmd, &message, &gateway) != 0 || execCommand(&cmd, &gateway, &response) != 0){
+        printf("footprint: command failed\n");
+        return 1;
+    }
+
+    printf("MAX_CMD_SIZE %d, MAX_ARGS %d, MAX_ID_SIZE %d, %d services\n",
+        MAX_CMD_SIZE, MAX_ARGS, MAX_ID_SIZE, FOOTPRINT_SERVICES);
+    printf("%-10s %6s\n", "struct", "bytes");
+    printf("%-10s %6zu\n", "CmdArg", sizeof(CmdArg));
+    printf("%-10s %6zu\n", "Protocol", sizeof(Protocol));
+    printf("%-10s %6zu\n", "Command", sizeof(Command));
+    printf("%-10s %6zu\n", "Service", sizeof(Service));
+    printf("%-10s %6zu\n", "Interface", sizeof(Interface));
+    printf("%-10s %6zu\n", "Gateway", sizeof(Gateway));
+    printf("%-10s %6zu\n", "Response", sizeof(Response));
+    printf("%-10s %6zu\n", "Parser", sizeof(Parser));
+    printf("%-10s %6zu\n", "tables", sizeof(mem));
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include "../../src/microRPCServer.h"
+
+#include <pthread.h>
+#include <stdio.h>  // printf
+#include <stdlib.h> // atoi & qsort
+#include <string.h> // strcmp
+#include <time.h>   // clock_gettime
+#include <sys/resource.h>
+
+// *** MICRO RPC SERVER LOAD TEST *** //
+// Runs the epoll server and LOAD_THREADS client threads over loopback. Every round each
+// client connection sends a pipeline of frames in one write, then reads all the responses.
+// Usage: microRPC_load [connections] [seconds] [pipeline] [--tcp]   (Unix socket by default)
+
+#define LOAD_MAX_CONNS 4096
+#define LOAD_THREADS 4
+#define LOAD_MAX_PIPELINE 64
+#define LOAD_SOCKET "microRPC_load.sock"
+#define LOAD_PORT 47001
+#define LOAD_FRAME "IF1,ECH,12345\n"
+#define LOAD_FRAME_LEN 14
+#define LOAD_RESPONSE_LEN 6 // "12345\n"
+#define MAX_SAMPLES 200000
+
+typedef struct Client{
+    int fds[LOAD_MAX_CONNS / LOAD_THREADS];
+    int numFds;
+    int pipeline;
+    double deadline;
+    unsigned long requests;
+    double *samples; // Round trip per connection and round, in us
+    int numSamples;
+    int failed;
+}Client;
+
+static int tcp = 0;
+
+static int echoService(Command *cmd, Response *response, void *data){
+    writeResponse(response, cmd->args[2].buf, cmd->args[2].len);
+    return 0;
+}
+
+static double nowUs(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmpDouble(const void *a, const void *b){
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int connectClient(void){
+    int fd;
+    if(tcp){
+        struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(LOAD_PORT)};
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) return fd;
+    }
+    else{
+        struct sockaddr_un addr = {.sun_family = AF_UNIX, .sun_path = LOAD_SOCKET};
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) return fd;
+    }
+    if(fd >= 0) close(fd);
+    return -1;
+}
+
+static int readResponses(int fd, int count){
+    // Read until count responses arrived, returns -1 if the server closed or rejected a frame
+    char buf[LOAD_MAX_PIPELINE * LOAD_RESPONSE_LEN];
+    int want = count * LOAD_RESPONSE_LEN;
+    int got = 0;
+    while(got < want){
+        ssize_t n = recv(fd, buf, want - got, 0);
+        if(n <= 0 || buf[0] == 'E') return -1;
+        got += (int)n;
+    }
+    return 0;
+}
+
+static void *clientMain(void *arg){
+    Client *client = arg;
+    char frames[LOAD_MAX_PIPELINE * LOAD_FRAME_LEN];
+    for(int i = 0; i < client->pipeline; i++){
+        uCcpy(&frames[i * LOAD_FRAME_LEN], LOAD_FRAME);
+    }
+    int len = client->pipeline * LOAD_FRAME_LEN;
+    while(nowUs() < client->deadline && client->failed == 0){
+        double start = nowUs();
+        for(int c = 0; c < client->numFds; c++){
+            if(send(client->fds[c], frames, len, MSG_NOSIGNAL) != len) client->failed = 1;
+        }
+        for(int c = 0; c < client->numFds && client->failed == 0; c++){
+            if(readResponses(client->fds[c], client->pipeline) != 0) client->failed = 1;
+            if(client->numSamples < MAX_SAMPLES){
+                client->samples[client->numSamples++] = nowUs() - start;
+            }
+        }
+        client->requests += (unsigned long)client->numFds * client->pipeline;
+    }
+    return 0;
+}
+
+static void *serverMain(void *arg){
+    runServer(arg);
+    return 0;
+}
+
+int main(int argc, char **argv){
+    int numConns = (argc > 1) ? atoi(argv[1]) : 256;
+    double seconds = (argc > 2) ? atof(argv[2]) : 2;
+    int pipeline = (argc > 3) ? atoi(argv[3]) : 8;
+    tcp = (argc > 4 && strcmp(argv[4], "--tcp") == 0);
+    if(numConns < LOAD_THREADS || numConns > LOAD_MAX_CONNS || pipeline < 1 || pipeline > LOAD_MAX_PIPELINE){
+        fprintf(stderr, "usage: %s [connections %d..%d] [seconds] [pipeline 1..%d] [--tcp]\n",
+                argv[0], LOAD_THREADS, LOAD_MAX_CONNS, LOAD_MAX_PIPELINE);
+        return 1;
+    }
+    // Both ends of every connection live in this process
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    // ** // Gateway // ** //
+    static unsigned char mem[2 * RPC_TABLE_BYTES(1)];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    static Gateway gateway;
+    initRPC(&gateway, &arena, 1);
+    static Protocol proto = {.numArgs = 3, .maxCmdLen = 20, .delim = ','};
+    static CmdArg format[] = {{.id = "TRGT", .maxSize = 5}, {.id = "SRVC", .maxSize = 5}, {.id = "DATA", .maxSize = 6}};
+    proto.cmdFormat = format;
+    static Interface interface;
+    createInterface(&interface, "IF1", &proto, NULL, &arena, 1);
+    addInterface(&gateway, &interface);
+    static Service echo = {.id = "ECH", .func = &echoService};
+    registerService(&interface, &echo);
+
+    // ** // Server // ** //
+    static Server server;
+    static Connection conns[LOAD_MAX_CONNS];
+    if(initServer(&server, &gateway, conns, LOAD_MAX_CONNS, '\n') != 0
+       || (tcp ? listenTcp(&server, "127.0.0.1", LOAD_PORT) : listenUnix(&server, LOAD_SOCKET)) != 0){
+        fprintf(stderr, "load: cannot listen\n");
+        return 1;
+    }
+    pthread_t serverThread;
+    pthread_create(&serverThread, 0, &serverMain, &server);
+
+    // ** // Clients // ** //
+    static Client clients[LOAD_THREADS];
+    pthread_t threads[LOAD_THREADS];
+    double deadline = nowUs() + seconds * 1e6;
+    int connected = 0;
+    for(int t = 0; t < LOAD_THREADS; t++){
+        Client *client = &clients[t];
+        client->pipeline = pipeline;
+        client->deadline = deadline;
+        client->samples = malloc(MAX_SAMPLES * sizeof(double));
+        for(int c = t; c < numConns; c += LOAD_THREADS){
+            int fd = connectClient();
+            if(fd < 0) break;
+            client->fds[client->numFds++] = fd;
+            connected++;
+        }
+    }
+    if(connected < numConns){
+        fprintf(stderr, "load: only %d of %d connections opened, check ulimit -n\n", connected, numConns);
+    }
+    double start = nowUs();
+    for(int t = 0; t < LOAD_THREADS; t++){
+        pthread_create(&threads[t], 0, &clientMain, &clients[t]);
+    }
+    unsigned long requests = 0;
+    int numSamples = 0;
+    int failed = 0;
+    static double samples[LOAD_THREADS * MAX_SAMPLES];
+    for(int t = 0; t < LOAD_THREADS; t++){
+        pthread_join(threads[t], 0);
+        requests += clients[t].requests;
+        failed |= clients[t].failed;
+        for(int i = 0; i < clients[t].numSamples; i++){
+            samples[numSamples++] = clients[t].samples[i];
+        }
+        for(int c = 0; c < clients[t].numFds; c++){
+            close(clients[t].fds[c]);
+        }
+        free(clients[t].samples);
+    }
+    double elapsed = (nowUs() - start) / 1e6;
+    stopServer(&server);
+    pthread_join(serverThread, 0);
+    closeServer(&server);
+    if(tcp == 0) unlink(LOAD_SOCKET);
+
+    qsort(samples, numSamples, sizeof(double), &cmpDouble);
+    printf("transport,connections,pipeline,seconds,requests,req_per_sec,round_p50_us,round_p99_us\n");
+    printf("%s,%d,%d,%.2f,%lu,%.0f,%.1f,%.1f\n", tcp ? "tcp" : "unix", connected, pipeline, elapsed, requests,
+           requests / elapsed, numSamples ? samples[numSamples / 2] : 0, numSamples ? samples[numSamples * 99 / 100] : 0);
+    if(failed){
+        fprintf(stderr, "load: a connection failed or a frame was rejected\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "../../src/microRPCJournal.h"
+
+#include <stdio.h>  // printf
+#include <stdlib.h> // atoi
+#include <string.h> // strcmp
+
+// *** MICRO RPC JOURNAL REPLAY *** //
+// Feeds a captured journal back through a Gateway and reports throughput and latency.
+// setupGateway mirrors the interfaces and services of the build under test; edit it to match.
+// Usage: microRPC_replay <journal> [--realtime]     replay as fast as possible or at the recorded rate
+//        microRPC_replay --capture <journal> <count> record a synthetic journal to try the tool
+
+#define NUM_SERVICES 4
+
+typedef struct ReplayEnv{
+    unsigned char mem[2 * RPC_TABLE_BYTES(NUM_SERVICES)];
+    RPCArena arena;
+    Gateway gateway;
+    Interface interface;
+    Service services[NUM_SERVICES];
+}ReplayEnv;
+
+static int replayService(Command *cmd, Response *response, void *data){
+    putResponse(response, "OK");
+    return 0;
+}
+
+static void setupGateway(ReplayEnv *env){
+    // Same layout as the tests: IF1 with TRGT,SRVC,PRAM,DATA and services TS0..TS3
+    static CmdArg format[] = {
+        {.id = "TRGT", .maxSize = 5},
+        {.id = "SRVC", .maxSize = 5},
+        {.id = "PRAM", .maxSize = 5},
+        {.id = "DATA", .maxSize = 5}
+    };
+    static Protocol proto = {
+        .numArgs = 4,
+        .maxCmdLen = 28,
+        .maxArgLen = 5,
+        .delim = ',',
+        .cmdFormat = format
+    };
+    initArena(&env->arena, env->mem, sizeof(env->mem));
+    initRPC(&env->gateway, &env->arena, 1);
+    createInterface(&env->interface, "IF1", &proto, NULL, &env->arena, NUM_SERVICES);
+    addInterface(&env->gateway, &env->interface);
+    for(int i = 0; i < NUM_SERVICES; i++){
+        Service *service = &env->services[i];
+        service->id[0] = 'T';
+        service->id[1] = 'S';
+        service->id[2] = '0' + i;
+        service->id[3] = '\0';
+        service->desc = "Replay Service";
+        service->func = &replayService;
+        registerService(&env->interface, service);
+    }
+}
+
+static int capture(ReplayEnv *env, const char *path, int count){
+    // Record count messages, one in eight is invalid, through the gateway's journal hook
+    Journal journal;
+    if(openJournal(&journal, path) != 0){
+        fprintf(stderr, "replay: cannot open %s\n", path);
+        return 1;
+    }
+    setJournal(&env->gateway, &journalMessage, &journal);
+    Command cmd = {0};
+    char msg[32];
+    for(int i = 0; i < count; i++){
+        int len = snprintf(msg, sizeof(msg), "%s,TS%d,%d,D%d", (i % 8 == 7) ? "XX1" : "IF1", i % NUM_SERVICES, i % 1000, i % 10);
+        Message message = {.buf = msg, .len = len + 1};
+        updateCommand(&cmd, &message, &env->gateway);
+    }
+    setJournal(&env->gateway, 0, 0);
+    if(closeJournal(&journal) != 0){
+        fprintf(stderr, "replay: write error on %s\n", path);
+        return 1;
+    }
+    printf("captured %d messages to %s\n", count, path);
+    return 0;
+}
+
+int main(int argc, char **argv){
+    static ReplayEnv env;
+    setupGateway(&env);
+    if(argc == 4 && strcmp(argv[1], "--capture") == 0){
+        return capture(&env, argv[2], atoi(argv[3]));
+    }
+    if(argc < 2){
+        fprintf(stderr, "usage: %s <journal> [--realtime] | --capture <journal> <count>\n", argv[0]);
+        return 1;
+    }
+    int realtime = (argc > 2 && strcmp(argv[2], "--realtime") == 0);
+
+    ReplayStats stats;
+    int ret = replayJournal(argv[1], &env.gateway, realtime, &stats);
+    if(ret != 0 && stats.messages == 0){
+        fprintf(stderr, "replay: cannot read %s\n", argv[1]);
+        return 1;
+    }
+    double seconds = stats.elapsedNs / 1e9;
+    printf("messages,valid,bytes,seconds,msgs_per_sec,mb_per_sec,mean_ns,p50_ns,p99_ns,max_ns\n");
+    printf("%llu,%llu,%llu,%.3f,%.0f,%.2f,%.0f,%llu,%llu,%llu\n",
+           (unsigned long long)stats.messages, (unsigned long long)stats.valid, (unsigned long long)stats.bytes,
+           seconds, (seconds > 0) ? stats.messages / seconds : 0, (seconds > 0) ? stats.bytes / seconds / 1e6 : 0,
+           (stats.messages > 0) ? (double)stats.totalNs / stats.messages : 0,
+           (unsigned long long)replayPercentile(&stats, 50), (unsigned long long)replayPercentile(&stats, 99),
+           (unsigned long long)stats.maxNs);
+    if(ret != 0){
+        fprintf(stderr, "replay: journal is truncated after %llu messages\n", (unsigned long long)stats.messages);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,180 @@
+#define MICRORPC_MULTICAST
+#include "../src/microRPCExecutor.h"
+
+#include <stdio.h>
+#include <unistd.h> // usleep
+
+// Color codes for printing
+#define RED   "\x1B[31m"
+#define GRN   "\x1B[32m"
+#define RESET "\x1B[0m"
+
+
+// *** EXECUTOR TESTS *** //
+#define NUM_PRODUCERS 4
+#define JOBS_PER_PRODUCER 2000
+
+static atomic_int callbacks;
+
+int sum_service(Command *cmd, Response *response, void *data){
+    putResponse(response, "OK");
+    return (int)cmd->argv[2].i;
+}
+
+void count_done(RPCJob *job, void *ctx){
+    atomic_fetch_add(&callbacks, 1);
+}
+
+typedef struct Producer{
+    Executor *executor;
+    Gateway *gateway;
+    char msgs[JOBS_PER_PRODUCER][16];
+    RPCJob jobs[JOBS_PER_PRODUCER];
+    char responses[JOBS_PER_PRODUCER][8];
+    int submitted;
+}Producer;
+
+void *producer_main(void *arg){
+    // Parse and submit commands without ever waiting on a service
+    Producer *producer = arg;
+    for(int i = 0; i < JOBS_PER_PRODUCER; i++){
+        snprintf(producer->msgs[i], sizeof(producer->msgs[i]), "IF1,SUM,%d", i % 1000);
+        Message msg = {.buf = producer->msgs[i], .len = uCsize(producer->msgs[i])};
+        Command cmd = {0};
+        updateCommand(&cmd, &msg, producer->gateway);
+        while(submitCommand(producer->executor, &producer->jobs[i], &cmd,
+                             producer->responses[i], sizeof(producer->responses[i]), &count_done, 0) != 0){
+            sched_yield(); // Queues are full, retry
+        }
+        producer->submitted++;
+    }
+    return 0;
+}
+
+int main(void){
+    unsigned char mem[RPC_TABLE_BYTES(2) + 2 * RPC_TABLE_BYTES(1)];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway gateway;
+    initRPC(&gateway, &arena, 2);
+    Protocol proto = {
+        .numArgs = 3,
+        .maxCmdLen = 28,
+        .delim = ',',
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 5 },
+            {.id = "SRVC", .maxSize = 5 },
+            {.id = "VAL", .maxSize = 5, .type = ARG_INT }
+        }
+    };
+    Interface interface = {0};
+    createInterface(&interface, "IF1", &proto, NULL, &arena, 1);
+    addInterface(&gateway, &interface);
+    Service sum = {.id = "SUM", .func = &sum_service};
+    registerService(&interface, &sum);
+    Interface interface2 = {0};
+    createInterface(&interface2, "IF2", &proto, NULL, &arena, 1);
+    addInterface(&gateway, &interface2);
+    Service sum2 = {.id = "SUM", .func = &sum_service};
+    registerService(&interface2, &sum2);
+
+    // Test case 1: jobs from several producers all complete with their own results
+    static Executor executor;
+    static Producer producers[NUM_PRODUCERS];
+    pthread_t threads[NUM_PRODUCERS];
+    startExecutor(&executor, 4, 0);
+    for(int p = 0; p < NUM_PRODUCERS; p++){
+        producers[p].executor = &executor;
+        producers[p].gateway = &gateway;
+        pthread_create(&threads[p], 0, &producer_main, &producers[p]);
+    }
+    for(int p = 0; p < NUM_PRODUCERS; p++){
+        pthread_join(threads[p], 0);
+    }
+    stopExecutor(&executor);
+    int ok = (atomic_load(&callbacks) == NUM_PRODUCERS * JOBS_PER_PRODUCER);
+    for(int p = 0; p < NUM_PRODUCERS; p++){
+        for(int i = 0; i < JOBS_PER_PRODUCER; i++){
+            RPCJob *job = &producers[p].jobs[i];
+            ok &= jobDone(job) && job->ret == i % 1000 && uStrcmp(producers[p].responses[i], "OK") == 0;
+        }
+    }
+    if (ok) {
+        printf(GRN "Executor: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Executor: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: an invalid command is not queued
+    static RPCJob job;
+    Command invalid = {0};
+    startExecutor(&executor, 1, 1);
+    if (submitCommand(&executor, &job, &invalid, 0, 0, 0, 0) == -1) {
+        printf(GRN "Executor: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Executor: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: polling a job routed by interface
+    char buf[] = "IF1,SUM,7";
+    Message msg = {.buf = buf, .len = uCsize(buf)};
+    Command cmd = {0};
+    updateCommand(&cmd, &msg, &gateway);
+    char response[8];
+    submitCommand(&executor, &job, &cmd, response, sizeof(response), 0, 0);
+    while(!jobDone(&job)){
+        sched_yield();
+    }
+    stopExecutor(&executor);
+    if (job.ret == 7 && job.response.len == 2) {
+        printf(GRN "Executor: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Executor: Test case 3 failed\n" RESET);
+    }
+
+    // Test case 4: producer A claims the head slot, producer B submits, then A publishes; both run
+    static RPCJob jobA, jobB;
+    char responseA[8], responseB[8];
+    startExecutor(&executor, 1, 0);
+    JobQueue *queue = &executor.queues[0];
+    size_t pos = atomic_fetch_add(&queue->head, 1); // A's claim, not yet published
+    submitCommand(&executor, &jobB, &cmd, responseB, sizeof(responseB), 0, 0);
+    usleep(10000); // B's token wakes the worker while A's slot is unpublished
+    jobA.cmd = cmd;
+    initResponse(&jobA.response, responseA, sizeof(responseA));
+    jobA.onDone = 0;
+    atomic_store(&jobA.done, 0);
+    queue->slots[pos & (EXECUTOR_QUEUE_SIZE - 1)].job = &jobA;
+    atomic_store_explicit(&queue->slots[pos & (EXECUTOR_QUEUE_SIZE - 1)].seq, pos + 1, memory_order_release);
+    sem_post(&queue->ready);
+    for(int i = 0; i < 1000 && !(jobDone(&jobA) && jobDone(&jobB)); i++){
+        usleep(1000); // Bounded, a lost job fails instead of hanging
+    }
+    ok = jobDone(&jobA) && jobDone(&jobB);
+    stopExecutor(&executor);
+    if (ok && jobA.ret == 7 && jobB.ret == 7) {
+        printf(GRN "Executor: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "Executor: Test case 4 failed\n" RESET);
+    }
+
+    // Test case 5: a multicast job runs on every selected interface, as execCommand would
+    char castBuf[] = "IF*,SUM,7";
+    Message castMsg = {.buf = castBuf, .len = uCsize(castBuf)};
+    Command castCmd = {0};
+    char castResponse[32];
+    ok = updateCommand(&castCmd, &castMsg, &gateway) == 0;
+    startExecutor(&executor, 1, 0);
+    ok = ok && submitCommand(&executor, &job, &castCmd, castResponse, sizeof(castResponse), 0, 0) == 0;
+    for(int i = 0; ok && i < 1000 && !jobDone(&job); i++){
+        usleep(1000);
+    }
+    ok = ok && jobDone(&job);
+    stopExecutor(&executor);
+    if (ok && job.ret == 0 && job.response.len == 14 && uCncmp("IF1,OK;IF2,OK;", castResponse, 14) == 0) {
+        printf(GRN "Executor: Test case 5 passed\n" RESET);
+    } else {
+        printf(RED "Executor: Test case 5 failed\n" RESET);
+    }
+    return 0;
+}
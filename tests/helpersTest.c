@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h> // rand
 #include "../include/helpers.h"
 
 // Color codes for printing
@@ -241,6 +242,107 @@ void test_uCTrunk(){
     }
 }
 
+void test_uCscan(){
+    // Fast scans must match the scalar scan for every length, offset and alignment
+    char src[200];
+    const char alphabet[] = "ab,\0";
+
+    // Test case 1: random buffers, dense and sparse matches
+    int ok = 1;
+    srand(1);
+    for(int iter = 0; iter < 2000; iter++){
+        int sparse = iter % 2;
+        for(int i = 0; i < (int)sizeof(src); i++){
+            src[i] = (sparse && rand() % 40 != 0) ? 'x' : alphabet[rand() % 4];
+        }
+        int start = rand() % 64;
+        int end = start + rand() % (sizeof(src) - start);
+        int ref = uCscanScalar(src, start, end, ',', '\0');
+#ifdef UC_SWAR
+        ok &= uCscanSwar(src, start, end, ',', '\0') == ref;
+#endif
+#ifdef UC_SIMD
+        ok &= uCscanSimd(src, start, end, ',', '\0') == ref;
+#endif
+        ok &= uCscan(src, start, end, ',', '\0') == ref;
+    }
+    if (ok) {
+        printf(GRN "uCscan: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "uCscan: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: no match returns end
+    for(int i = 0; i < (int)sizeof(src); i++){
+        src[i] = 'x';
+    }
+    if (uCscan(src, 3, 150, ',', '\0') == 150 && uCscan(src, 7, 7, ',', '\0') == 7) {
+        printf(GRN "uCscan: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "uCscan: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: string scans at every alignment
+    ok = 1;
+    for(int iter = 0; iter < 2000; iter++){
+        for(int i = 0; i < (int)sizeof(src) - 1; i++){
+            src[i] = (rand() % 30 == 0) ? alphabet[rand() % 4] : 'x';
+        }
+        src[sizeof(src) - 1] = '\0';
+        const char *str = &src[rand() % 32];
+        const char *ref = uCscanStrScalar(str, ',');
+#ifdef UC_SWAR
+        ok &= uCscanStrSwar(str, ',') == ref;
+#endif
+        ok &= uCscanStr(str, ',') == ref;
+        ok &= uCsize((char *)str) == (unsigned int)(uCscanStrScalar(str, '\0') - str + 1);
+    }
+    if (ok) {
+        printf(GRN "uCscan: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "uCscan: Test case 3 failed\n" RESET);
+    }
+}
+
+void test_uCtoNumber(){
+    // Test case 1: signed and unsigned integers
+    long i1, i2;
+    unsigned long u1, u2;
+    if (uCtoInt("-123", 4, &i1) == 0 && i1 == -123 && uCtoInt("+45x", 3, &i2) == 0 && i2 == 45
+        && uCtoUint("4096", 4, 10, &u1) == 0 && u1 == 4096 && uCtoUint("fF10", 4, 16, &u2) == 0 && u2 == 0xFF10) {
+        printf(GRN "uCtoNumber: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "uCtoNumber: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: invalid chars, empty input and overflow are rejected
+    if (uCtoInt("12a", 3, &i1) == -1 && uCtoInt("-", 1, &i1) == -1 && uCtoUint("", 0, 10, &u1) == -1
+        && uCtoUint("1g", 2, 16, &u1) == -1 && uCtoUint("99999999999999999999999", 23, 10, &u1) == -1) {
+        printf(GRN "uCtoNumber: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "uCtoNumber: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: fixed point
+    long f1, f2, f3, f4;
+    if (uCtoFixed("1.5", 3, 2, &f1) == 0 && f1 == 150 && uCtoFixed("-0.25", 5, 2, &f2) == 0 && f2 == -25
+        && uCtoFixed("7", 1, 3, &f3) == 0 && f3 == 7000 && uCtoFixed(".5", 2, 1, &f4) == 0 && f4 == 5
+        && uCtoFixed("1.234", 5, 2, &f1) == -1) {
+        printf(GRN "uCtoNumber: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "uCtoNumber: Test case 3 failed\n" RESET);
+    }
+
+    // Test case 4: floats
+    float g1, g2, g3;
+    if (uCtoFloat("-1.25", 5, &g1) == 0 && g1 == -1.25f && uCtoFloat("2.5e2", 5, &g2) == 0 && g2 == 250.0f
+        && uCtoFloat("3", 1, &g3) == 0 && g3 == 3.0f && uCtoFloat("1.2.3", 5, &g1) == -1 && uCtoFloat(".", 1, &g1) == -1) {
+        printf(GRN "uCtoNumber: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "uCtoNumber: Test case 4 failed\n" RESET);
+    }
+}
+
 
 int main() {
     test_uStrlen();
@@ -248,6 +350,8 @@ int main() {
     test_uStrcmp();
     test_uCSplit();
     test_uCTrunk();
+    test_uCscan();
+    test_uCtoNumber();
     return 0;
 }
 
@@ -1,114 +1,64 @@
 #ifndef __DATATABLE_H__
 #define __DATATABLE_H__
 
-#include "../../include/helpers.h"
-/* Example implementation of a hash table storig config data keys and values */
+#include "../../include/lookupTable.h"
+/* Example implementation of a hash table storing config data keys and values */
 
 // Lookup Table Definitions
-#define NUM_NODES  10 //  Number of nodes in the Lookup Table
-#define MAX_MEMBERS  4 // Maximum number of members per node
-#define DATA_MAX_LEN  10 // Maximum length of data
-#define KEY_LEN  5 // Maximum length of a key
+#define NUM_ENTRIES  16 // Slots of the table, holds NUM_ENTRIES - 1 members
+#define KEY_LEN  5 // Maximum length of a node or member id
 
 
 
+typedef struct DataTable{
+    LookupTable table;
+    LTEntry entries[NUM_ENTRIES]; // Keys and values stored inline
+} DataTable; // Holds the data of every node member, keyed "node:member"
 
-
-typedef struct Member{
-    char id[KEY_LEN]; 
-    char data[DATA_MAX_LEN]; 
-} Member; // Maps Data to a id
-
-typedef struct Node{
-    char id[KEY_LEN]; 
-    Member *members[MAX_MEMBERS]; 
-    int count; 
-} Node; // Holds Homogeneous data id links
-
-typedef struct LookupTable{
-    Node *nodes[NUM_NODES]; 
-    int count; 
-} LookupTable; // Holds all Data Nodes 
-
-void initLookupTable(LookupTable *table, int numNodes){
-    // Initialise the table to 0
-    for(int i = 0; i < numNodes; i++){
-        table->nodes[i] = 0; // Init all nodes to 0
-    }
-    table->count = 0;
-}
-
-void createNode(Node *node, char *id){
-    uCcpy(node->id,id); // Copy to the id as we need to keep the id constant. 
-    node->count = 0; // Number of members in the node
-    }
-
-int addMember(Node *node, Member *Member){
-    int idx = node->count; // Next Index of the member Available
-    if(idx < MAX_MEMBERS){ // Check if the node is full 
-        node->members[idx] = Member; // add pointer to the member to the node
-    node->count++; // Increment the count
-    } else{
-        return -1; // Node is full
+static int dataKey(char *key, char *node, char *id){
+    // Build the "node:member" key of a member
+    int nodeLen = uCsize(node) - 1;
+    int idLen = uCsize(id) - 1;
+    if(nodeLen + 1 > KEY_LEN || idLen + 1 > KEY_LEN){
+        return -1; // Id is too long
     }
+    uCcpy(key, node);
+    key[nodeLen] = ':';
+    uCcpy(&key[nodeLen + 1], id);
     return 0;
 }
 
-int addNode(LookupTable *table, Node *node){
-    // Add a node to the table 
-    if (table->count >= NUM_NODES){
-        return -1; // Table is full
-    }
-    int index = hash(node->id,NUM_NODES); // Get the index of the node
-    if (table->nodes[index] != 0){
-        return -1; // Node already exists at the index
-    }
-    table->nodes[index] = node; // Add the node to the table
-    table->count++; 
-    return 0;
+void initDataTable(DataTable *data){
+    // Initialise an empty table
+    initLookupTable(&data->table, data->entries, NUM_ENTRIES);
 }
 
-char *getMemberData(Node *node, char *id){
+char *getMemberData(DataTable *data, char *node, char *id){
     // Return the pointer to the member value
-    for(int i = 0; i < node->count; i++){
-        if (uStrcmp(node->members[i]->id,id) == 0){
-            return node->members[i]->data; // Return the data
-        }
+    char key[2 * KEY_LEN];
+    if(dataKey(key, node, id) != 0){
+        return 0; // Member cannot exist
     }
-    return 0; // Member does not exist
+    return lookupGet(&data->table, key); // 0 if the member does not exist
 }
 
-int setMemberData(Node *node, char *id, char *data){
-    // Set the value of a member
-    for(int i = 0; i < node->count; i++){
-        if (uStrcmp(node->members[i]->id,id) == 0){
-            uCcpy(node->members[i]->data,data); // Copy the data to the member
-            return 0;
-        }
+int setMemberData(DataTable *data, char *node, char *id, char *value){
+    // Set the value of a member, adding it if needed
+    char key[2 * KEY_LEN];
+    if(dataKey(key, node, id) != 0){
+        return -1; // Id is too long
     }
-    return -1; // Member does not exist
+    return lookupSet(&data->table, key, value); // -1 if the value is too long or the table is full
 }
 
-int adjMemberData(Node *node, char *id, char *data){
-    // Adjust the value of a member
-    //placeholder
-    if(setMemberData(node,id,data) !=0){
-        return -1;// Member does not exist
-    }
-    return 0; 
-}
-
-Node *getNode(LookupTable *table, char *id){
-    // Return the pointer to the node
-    int index = hash(id,NUM_NODES);
-    if (index >= NUM_NODES){
-        return 0; // Node index is out of range
-    }
-    if (table->nodes[index] == 0){
-        return 0; // Node does not exist at the index
+int removeMember(DataTable *data, char *node, char *id){
+    // Remove a member and its value
+    char key[2 * KEY_LEN];
+    if(dataKey(key, node, id) != 0){
+        return -1; // Member cannot exist
     }
-    return table->nodes[index]; 
+    return lookupRemove(&data->table, key);
 }
 
 
-#endif
\ No newline at end of file
+#endif
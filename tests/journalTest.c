@@ -0,0 +1,108 @@
+#include "../src/microRPCJournal.h"
+
+#include <stdio.h>
+
+// Color codes for printing
+#define RED   "\x1B[31m"
+#define GRN   "\x1B[32m"
+#define RESET "\x1B[0m"
+
+
+// *** JOURNAL TESTS *** //
+#define JOURNAL_PATH "journalTest.bin"
+
+int echo_service(Command *cmd, Response *response, void *data){
+    putResponse(response, "OK");
+    return 0;
+}
+
+int main(void){
+    unsigned char mem[2 * RPC_TABLE_BYTES(1)];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway gateway;
+    initRPC(&gateway, &arena, 1);
+    Protocol proto = {
+        .numArgs = 3,
+        .maxCmdLen = 20,
+        .maxArgLen = 5,
+        .delim = ',',
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 5},
+            {.id = "SRVC", .maxSize = 5},
+            {.id = "DATA", .maxSize = 5}
+        }
+    };
+    Interface interface = {0};
+    createInterface(&interface, "IF1", &proto, NULL, &arena, 1);
+    addInterface(&gateway, &interface);
+    Service echo = {.id = "ECH", .desc = "Echo", .func = &echo_service};
+    registerService(&interface, &echo);
+
+    // Capture two valid messages, one invalid message and one streamed frame
+    char *msgs[] = {"IF1,ECH,1", "XX1,ECH,2", "IF1,ECH,3"};
+    Journal journal;
+    remove(JOURNAL_PATH);
+    openJournal(&journal, JOURNAL_PATH);
+    setJournal(&gateway, &journalMessage, &journal);
+    Command cmd = {0};
+    for(int i = 0; i < 3; i++){
+        Message msg = {.buf = msgs[i], .len = uCsize(msgs[i])};
+        updateCommand(&cmd, &msg, &gateway);
+    }
+    Parser parser;
+    initParser(&parser, &gateway, '\n');
+    int used;
+    feedParser(&parser, &cmd, "IF1,ECH,4\n", 10, &used);
+    int closed = closeJournal(&journal);
+
+    // Test case 1: every message is read back in order with its bytes
+    char buf[32];
+    JournalReader reader;
+    JournalRecord record;
+    uint64_t lastTs = 0;
+    int records = 0;
+    int ordered = 1;
+    int ret = openJournalReader(&reader, JOURNAL_PATH);
+    while(ret == 0 && readJournal(&reader, &record, buf, sizeof(buf)) == 1){
+        ordered &= (record.ts >= lastTs && record.msg.len == 10);
+        ordered &= (records == 3) ? uCncmp(buf, "IF1,ECH,4", 9) == 0 : uCncmp(buf, msgs[records], 9) == 0;
+        lastTs = record.ts;
+        records++;
+    }
+    closeJournalReader(&reader);
+    if (closed == 0 && journal.records == 4 && records == 4 && ordered) {
+        printf(GRN "Journal: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Journal: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: replay parses and executes every record without journaling it again
+    ReplayStats stats;
+    openJournal(&journal, JOURNAL_PATH);
+    ret = replayJournal(JOURNAL_PATH, &gateway, 0, &stats);
+    uint64_t histTotal = 0;
+    for(int i = 0; i < REPLAY_HIST_BUCKETS; i++){
+        histTotal += stats.hist[i];
+    }
+    if (ret == 0 && stats.messages == 4 && stats.valid == 3 && stats.bytes == 40 && histTotal == 4
+        && journal.records == 0 && gateway.journal == &journalMessage && replayPercentile(&stats, 100) >= stats.maxNs / 2) {
+        printf(GRN "Journal: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Journal: Test case 2 failed\n" RESET);
+    }
+    setJournal(&gateway, 0, 0);
+    closeJournal(&journal);
+
+    // Test case 3: a truncated record is reported
+    FILE *file = fopen(JOURNAL_PATH, "ab");
+    fwrite("\1\2\3\4\5\6\7\10\11", 1, 9, file);
+    fclose(file);
+    if (replayJournal(JOURNAL_PATH, &gateway, 0, &stats) == -1 && stats.messages == 4) {
+        printf(GRN "Journal: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Journal: Test case 3 failed\n" RESET);
+    }
+    remove(JOURNAL_PATH);
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include "../include/lookupTable.h"
+
+// Color codes for printing
+#define RED   "\x1B[31m"
+#define GRN   "\x1B[32m"
+#define RESET "\x1B[0m"
+
+
+// *** LOOKUP TABLE TESTS *** //
+#define CHURN_CYCLES 10000
+
+static int checkChurn(LookupTable *table, char keys[][LT_KEY_SIZE], int *live, int numKeys){
+    // Every live key holds its own name as value, every other key is missing
+    for(int k = 0; k < numKeys; k++){
+        char *value = lookupGet(table, keys[k]);
+        if(live[k] ? (value == 0 || uStrcmp(value, keys[k]) != 0) : value != 0){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void test_lookupTable() {
+    LTEntry entries[8];
+    LookupTable table;
+    initLookupTable(&table, entries, 8);
+
+    // Test case 1: colliding keys are all stored and found, slices match exact keys only
+    char *keys[5] = {"a", "i", "q", "y", "b"}; // 'a', 'i', 'q' and 'y' share a home slot in 8
+    int ok = 1;
+    for(int i = 0; i < 5; i++){
+        ok &= lookupSet(&table, keys[i], keys[i]) == 0;
+    }
+    for(int i = 0; i < 5; i++){
+        char *value = lookupGet(&table, keys[i]);
+        ok &= value != 0 && uStrcmp(value, keys[i]) == 0;
+    }
+    if (ok && table.count == 5 && lookupGet(&table, "c") == 0 && lookupGetLen(&table, "qq", 1) != 0
+        && lookupGetLen(&table, "qq", 2) == 0) {
+        printf(GRN "lookupTable: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "lookupTable: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: setting an existing key updates its value in place
+    char *before = lookupGet(&table, "q");
+    if (lookupSet(&table, "q", "new") == 0 && lookupGet(&table, "q") == before && uStrcmp(before, "new") == 0
+        && table.count == 5) {
+        printf(GRN "lookupTable: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "lookupTable: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: keys probed past a removed key are still found, the tombstone is reused
+    if (lookupRemove(&table, "i") == 0 && lookupRemove(&table, "i") == -1 && lookupGet(&table, "i") == 0
+        && lookupGet(&table, "y") != 0 && lookupSet(&table, "i", "back") == 0 && table.tombstones == 0
+        && uStrcmp(lookupGet(&table, "i"), "back") == 0) {
+        printf(GRN "lookupTable: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "lookupTable: Test case 3 failed\n" RESET);
+    }
+
+    // Test case 4: too long keys or values and a full table are refused
+    if (lookupSet(&table, "longkeyname", "v") == -1 && lookupSet(&table, "k", "longvaluexx") == -1
+        && lookupSet(&table, "c", "c") == 0 && lookupSet(&table, "d", "d") == 0 && lookupSet(&table, "e", "e") == -1
+        && table.count == 7 && lookupGet(&table, "e") == 0) {
+        printf(GRN "lookupTable: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "lookupTable: Test case 4 failed\n" RESET);
+    }
+
+    // Test case 5: insert and remove churn never fills the table with tombstones
+    char churnKeys[12][LT_KEY_SIZE];
+    int live[12] = {0};
+    initLookupTable(&table, entries, 8);
+    for(int k = 0; k < 12; k++){
+        churnKeys[k][0] = 'k';
+        uCfromUint(&churnKeys[k][1], k);
+    }
+    ok = 1;
+    unsigned int seed = 1;
+    for(int i = 0; i < CHURN_CYCLES && ok; i++){
+        seed = seed * 1103515245 + 12345;
+        int k = (seed >> 16) % 12;
+        if(live[k]){
+            ok &= lookupRemove(&table, churnKeys[k]) == 0;
+            live[k] = 0;
+        }
+        else if(table.count < 7){
+            ok &= lookupSet(&table, churnKeys[k], churnKeys[k]) == 0;
+            live[k] = 1;
+        }
+        ok &= checkChurn(&table, churnKeys, live, 12) == 0 && table.count + table.tombstones < 8;
+    }
+    if (ok) {
+        printf(GRN "lookupTable: Test case 5 passed\n" RESET);
+    } else {
+        printf(RED "lookupTable: Test case 5 failed\n" RESET);
+    }
+}
+
+int main(){
+    test_lookupTable();
+    return 0;
+}
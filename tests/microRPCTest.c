@@ -1,6 +1,14 @@
-#include "include/microRPCTest.h"
 #include <stdio.h>
 
+// Metrics with a fake clock that advances one tick per read
+static unsigned long testTicks = 0;
+#define MICRORPC_METRICS
+#define MICRORPC_CACHE
+#define MICRORPC_ASYNC
+#define MICRORPC_MULTICAST
+#define RPC_NOW() (testTicks++)
+#include "include/microRPCTest.h"
+
 
 // Color codes for printing
 #define RED   "\x1B[31m"
@@ -10,28 +18,999 @@
 
 // *** MICRO RPC TESTS *** //
 
-int test_service1(Command *cmd,char *response, void *data){
-	uCcpy(response, "TS1OK");
+int test_service1(Command *cmd,Response *response, void *data){
+	putResponse(response, "TS1OK");
     return 0;
 }
 
-int test_service2(Command *cmd,char *response, void *data){
-	uCcpy(response, "TS2OK");
+int test_service2(Command *cmd,Response *response, void *data){
+	putResponse(response, "TS2OK");
     return 0;
 }
 
 
+// Same layout as testproto1 with a typed argument, parser generated at build time
+#define GEN_ARGS(X) X(TRGT, 5, ARG_STR, 0) X(SRVC, 5, ARG_STR, 0) X(VAL, 6, ARG_INT, 0) X(DATA, 5, ARG_STR, 0)
+RPC_PROTOCOL(genProto, ',', 28, GEN_ARGS)
+
+
+void test_lookup(Gateway *gateway, Interface *interface, Service *service){
+    // Test case 1: duplicate ids are rejected
+    if (addInterface(gateway, interface) == -1 && registerService(interface, service) == -1) {
+        printf(GRN "Lookup: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Lookup: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: a prefix of a registered id does not match
+    if (getInterface(gateway, "IF") == 0 && getService(interface, "TS") == 0) {
+        printf(GRN "Lookup: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Lookup: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: a full table resolves every id and rejects one more
+    const int numServices = 10;
+    unsigned char mem[RPC_TABLE_BYTES(10)];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Interface full = {0};
+    createInterface(&full, "FUL", interface->proto, NULL, &arena, numServices);
+    Service services[numServices + 1];
+    for(int i = 0; i < numServices + 1; i++){
+        services[i] = *service;
+        services[i].id[0] = 'S';
+        services[i].id[1] = 'A' + i;
+        services[i].id[2] = '\0';
+    }
+    int ok = 1;
+    for(int i = 0; i < numServices; i++){
+        ok &= registerService(&full, &services[i]) == 0;
+    }
+    ok &= registerService(&full, &services[numServices]) == -1;
+    for(int i = 0; i < numServices; i++){
+        ok &= getService(&full, services[i].id) == &services[i];
+    }
+    if (ok) {
+        printf(GRN "Lookup: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Lookup: Test case 3 failed\n" RESET);
+    }
+
+    // Test case 4: a table takes only what its capacity needs, an exhausted arena is refused
+    unsigned char smallMem[RPC_TABLE_BYTES(2)];
+    initArena(&arena, smallMem, sizeof(smallMem));
+    Interface fits = {0};
+    Interface refused = {0};
+    ok = createInterface(&fits, "FIT", interface->proto, NULL, &arena, 2) == 0;
+    ok &= arena.used <= (int)RPC_TABLE_BYTES(2) && registerService(&fits, service) == 0;
+    ok &= createInterface(&refused, "REF", interface->proto, NULL, &arena, 2) == -1;
+    ok &= registerService(&refused, service) == -1 && getService(&refused, "TS1") == 0;
+    if (ok) {
+        printf(GRN "Lookup: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "Lookup: Test case 4 failed\n" RESET);
+    }
+
+    // Test case 5: packed ids match whole ids only, also for argument ids
+    char buf[] = "IF1,TS1,1111,AAAA";
+    Message msg = {.buf = buf, .len = uCsize(buf)};
+    Command cmd = {0};
+    char arg[5];
+    updateCommand(&cmd, &msg, gateway);
+    if (packId("TS1", 3) != packId("TS10", 4) && packId("TOOLONG", 7) == 0 && extractArg(arg, &cmd, "PRA") == -1
+        && extractArg(arg, &cmd, "PRAMX") == -1 && extractArg(arg, &cmd, "PRAM") == 2 && uStrcmp(arg, "1111") == 0) {
+        printf(GRN "Lookup: Test case 5 passed\n" RESET);
+    } else {
+        printf(RED "Lookup: Test case 5 failed\n" RESET);
+    }
+}
+
+
+void test_reentrant(Gateway *gateway){
+    // Test case 1: two commands for one interface keep their own arguments
+    char buf1[] = "IF1,TS1,1111,AAAA";
+    char buf2[] = "IF1,TS2,2222,BBBB";
+    Message msg1 = {.buf = buf1, .len = uCsize(buf1)};
+    Message msg2 = {.buf = buf2, .len = uCsize(buf2)};
+    Command cmd1 = {0};
+    Command cmd2 = {0};
+    updateCommand(&cmd1, &msg1, gateway);
+    updateCommand(&cmd2, &msg2, gateway);
+    char param1[5], param2[5];
+    extractArg(param1, &cmd1, "PRAM");
+    extractArg(param2, &cmd2, "PRAM");
+    if (cmd1.valid && cmd2.valid && uStrcmp(param1, "1111") == 0 && uStrcmp(param2, "2222") == 0) {
+        printf(GRN "Reentrant: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Reentrant: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: the target service is resolved at update time
+    if (cmd1.service != 0 && cmd2.service != 0 && cmd1.service != cmd2.service
+        && cmd1.interface == cmd2.interface) {
+        printf(GRN "Reentrant: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Reentrant: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: clearing one command leaves the other intact
+    clearCommand(&cmd1);
+    extractArg(param2, &cmd2, "DATA");
+    if (cmd1.valid == 0 && uStrcmp(param2, "BBBB") == 0) {
+        printf(GRN "Reentrant: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Reentrant: Test case 3 failed\n" RESET);
+    }
+}
+
+
+int feedAll(Parser *parser, Command *cmd, char *data, int len, int chunk, int *results){
+    // Feed data in chunks of the given size and record every completed or rejected frame
+    int count = 0;
+    for(int off = 0; off < len; off += chunk){
+        int n = (len - off < chunk) ? len - off : chunk;
+        int pos = 0;
+        while(pos < n){
+            int used = 0;
+            int ret = feedParser(parser, cmd, &data[off + pos], n - pos, &used);
+            pos += used;
+            if(ret != 0){
+                results[count++] = ret;
+            }
+        }
+    }
+    return count;
+}
+
+void test_stream(Gateway *gateway){
+    Parser parser;
+    Command cmd = {0};
+    initParser(&parser, gateway, '\n');
+    char stream[] = "IF1,TS1,0000,DATA\nIF1,TS1,00000,D\nIFx,TS1,0,D\nIF1,TS2,1,2\nIF1,TSx\nIF1,TS1,0,D,E\n";
+    int expected[] = {1, -1, -1, 1, -1, -1};
+    int numFrames = sizeof(expected) / sizeof(expected[0]);
+
+    // Test case 1..3: byte at a time, small chunks and one chunk give the same frames
+    int chunks[] = {1, 4, sizeof(stream) - 1};
+    for(int c = 0; c < 3; c++){
+        int results[10];
+        int count = feedAll(&parser, &cmd, stream, sizeof(stream) - 1, chunks[c], results);
+        int ok = (count == numFrames);
+        for(int i = 0; ok && i < numFrames; i++){
+            ok = (results[i] == expected[i]);
+        }
+        if (ok) {
+            printf(GRN "Stream: Test case %d passed\n" RESET, c + 1);
+        } else {
+            printf(RED "Stream: Test case %d failed\n" RESET, c + 1);
+        }
+    }
+
+    // Test case 4: the ready command holds the arguments of the last frame
+    char frame[] = "IF1,TS2,12,AB\n";
+    int used = 0;
+    int ret = feedParser(&parser, &cmd, frame, sizeof(frame) - 1, &used);
+    char data[5];
+    extractArg(data, &cmd, "DATA");
+    if (ret == 1 && cmd.valid && used == sizeof(frame) - 1 && uStrcmp(data, "AB") == 0
+        && execCommand(&cmd, gateway, NULL) == 0) {
+        printf(GRN "Stream: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "Stream: Test case 4 failed\n" RESET);
+    }
+
+    // Test case 5: an oversized argument is rejected before its frame ends
+    char partial[] = "IF1,TS1,00000";
+    ret = feedParser(&parser, &cmd, partial, sizeof(partial) - 1, &used);
+    char rest[] = "0000\nIF1,TS1,0,D\n";
+    int ret2 = feedParser(&parser, &cmd, rest, sizeof(rest) - 1, &used);
+    if (ret == -1 && used == sizeof(rest) - 1 && ret2 == 1) {
+        printf(GRN "Stream: Test case 5 passed\n" RESET);
+    } else {
+        printf(RED "Stream: Test case 5 failed\n" RESET);
+    }
+}
+
+
+void test_binary(Service *service1, Service *service2){
+    unsigned char mem[3 * RPC_TABLE_BYTES(2)];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway binGateway;
+    Gateway *gateway = &binGateway;
+    initRPC(gateway, &arena, 2);
+    Protocol fixedProto = {
+        .numArgs = 4,
+        .mode = PROTO_FIXED,
+        .maxCmdLen = 13,
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 3 },
+            {.id = "SRVC", .maxSize = 4 },
+            {.id = "PRAM", .maxSize = 2 },
+            {.id = "DATA", .maxSize = 4 }
+        }
+    };
+    Protocol tlvProto = {
+        .numArgs = 4,
+        .mode = PROTO_TLV,
+        .maxCmdLen = 28,
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 4 },
+            {.id = "SRVC", .maxSize = 5 },
+            {.id = "PRAM", .maxSize = 5 },
+            {.id = "DATA", .maxSize = 5 }
+        }
+    };
+    Interface fixedInterface = {0};
+    Interface tlvInterface = {0};
+    createInterface(&fixedInterface, "BFX", &fixedProto, NULL, &arena, 2);
+    createInterface(&tlvInterface, "BTL", &tlvProto, NULL, &arena, 2);
+    addInterface(gateway, &fixedInterface);
+    addInterface(gateway, &tlvInterface);
+    registerService(&fixedInterface, service1);
+    registerService(&tlvInterface, service2);
+    Command cmd = {0};
+
+    // Test case 1: fixed width fields, service id padded with '\0'
+    char fixed[] = {'B','F','X', 'T','S','1',0, 1,2, 0,1,0,0};
+    Message msg = {.buf = fixed, .len = sizeof(fixed)};
+    updateCommand(&cmd, &msg, gateway);
+    if (cmd.valid && cmd.service == service1 && cmd.args[3].len == 4 && cmd.args[3].buf[1] == 1
+        && execCommand(&cmd, gateway, NULL) == 0) {
+        printf(GRN "Binary: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Binary: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: fixed width message of the wrong size is rejected
+    msg.len = sizeof(fixed) - 1;
+    updateCommand(&cmd, &msg, gateway);
+    if (cmd.valid == 0) {
+        printf(GRN "Binary: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Binary: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: TLV records in any order
+    char tlv[] = {'B','T','L', 3,2,'A','B', 1,3,'T','S','2'};
+    msg.buf = tlv;
+    msg.len = sizeof(tlv);
+    updateCommand(&cmd, &msg, gateway);
+    char param[5];
+    extractArg(param, &cmd, "PRAM");
+    if (cmd.valid && cmd.service == service2 && uStrcmp(param, "AB") == 0 && cmd.args[2].buf == 0) {
+        printf(GRN "Binary: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Binary: Test case 3 failed\n" RESET);
+    }
+
+    // Test case 4: malformed TLV records are rejected
+    char duplicate[] = {'B','T','L', 1,3,'T','S','2', 1,3,'T','S','2'};
+    char tooLong[] = {'B','T','L', 1,3,'T','S','2', 3,5,'1','2','3','4','5'};
+    char truncated[] = {'B','T','L', 1,3,'T','S'};
+    char *bad[] = {duplicate, tooLong, truncated};
+    int badLen[] = {sizeof(duplicate), sizeof(tooLong), sizeof(truncated)};
+    int ok = 1;
+    for(int i = 0; i < 3; i++){
+        msg.buf = bad[i];
+        msg.len = badLen[i];
+        updateCommand(&cmd, &msg, gateway);
+        ok &= (cmd.valid == 0);
+    }
+    if (ok) {
+        printf(GRN "Binary: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "Binary: Test case 4 failed\n" RESET);
+    }
+}
+
+
+void test_typed(Service *service){
+    unsigned char mem[3 * RPC_TABLE_BYTES(2)];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway typedGateway;
+    initRPC(&typedGateway, &arena, 2);
+    Protocol typedProto = {
+        .numArgs = 5,
+        .maxCmdLen = 40,
+        .delim = ',',
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 4 },
+            {.id = "SRVC", .maxSize = 5 },
+            {.id = "INT", .maxSize = 8, .type = ARG_INT },
+            {.id = "FIX", .maxSize = 8, .type = ARG_FIXED, .scale = 2 },
+            {.id = "FLT", .maxSize = 8, .type = ARG_FLOAT }
+        }
+    };
+    Protocol binProto = {
+        .numArgs = 4,
+        .mode = PROTO_FIXED,
+        .maxCmdLen = 14,
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 3 },
+            {.id = "SRVC", .maxSize = 3 },
+            {.id = "INT", .maxSize = 4, .type = ARG_INT },
+            {.id = "HEX", .maxSize = 4, .type = ARG_HEX }
+        }
+    };
+    Interface typedInterface = {0};
+    Interface binInterface = {0};
+    createInterface(&typedInterface, "TYP", &typedProto, NULL, &arena, 2);
+    createInterface(&binInterface, "TYB", &binProto, NULL, &arena, 2);
+    addInterface(&typedGateway, &typedInterface);
+    addInterface(&typedGateway, &binInterface);
+    registerService(&typedInterface, service);
+    registerService(&binInterface, service);
+    Command cmd = {0};
+
+    // Test case 1: text arguments are decoded by type while parsing
+    char text[] = "TYP,TS1,-42,3.5,1.5e1";
+    Message msg = {.buf = text, .len = uCsize(text)};
+    updateCommand(&cmd, &msg, &typedGateway);
+    if (cmd.valid && cmd.argv[2].i == -42 && cmd.argv[3].i == 350 && cmd.argv[4].f == 15.0f
+        && cmd.args[1].len == 3 && cmd.argv[1].u == 0) {
+        printf(GRN "Typed: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Typed: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: a value that does not match its type invalidates the command
+    char bad[] = "TYP,TS1,4x2,3.5,1";
+    msg.buf = bad;
+    msg.len = uCsize(bad);
+    updateCommand(&cmd, &msg, &typedGateway);
+    if (cmd.valid == 0) {
+        printf(GRN "Typed: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Typed: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: binary arguments are decoded little endian
+    char bin[] = {'T','Y','B', 'T','S','1', 0xFE,0xFF,0xFF,0xFF, 0x78,0x56,0x34,0x12};
+    msg.buf = bin;
+    msg.len = sizeof(bin);
+    updateCommand(&cmd, &msg, &typedGateway);
+    if (cmd.valid && cmd.argv[2].i == -2 && cmd.argv[3].u == 0x12345678) {
+        printf(GRN "Typed: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Typed: Test case 3 failed\n" RESET);
+    }
+}
+
+
+void test_response(Gateway *gateway){
+    char buf[] = "IF1,TS1,0,D";
+    Message msg = {.buf = buf, .len = uCsize(buf)};
+    Command cmd = {0};
+    updateCommand(&cmd, &msg, gateway);
+
+    // Test case 1: the service writes into the caller's buffer
+    char txBuf[8];
+    Response res;
+    initResponse(&res, txBuf, sizeof(txBuf));
+    execCommand(&cmd, gateway, &res);
+    if (res.len == 5 && uStrcmp(txBuf, "TS1OK") == 0 && res.overflow == 0) {
+        printf(GRN "Response: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Response: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: a write that does not fit is refused and flagged
+    char small[4];
+    initResponse(&res, small, sizeof(small));
+    execCommand(&cmd, gateway, &res);
+    if (res.len == 0 && res.overflow == 1 && small[0] == '\0') {
+        printf(GRN "Response: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Response: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: formatting in place
+    initResponse(&res, txBuf, sizeof(txBuf));
+    putResponse(&res, "A");
+    int avail;
+    char *space = reserveResponse(&res, &avail);
+    space[0] = 'B';
+    space[1] = 'C';
+    if (avail == 6 && commitResponse(&res, 2) == 0 && uStrcmp(txBuf, "ABC") == 0 && commitResponse(&res, 5) == -1) {
+        printf(GRN "Response: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Response: Test case 3 failed\n" RESET);
+    }
+}
+
+
+void test_sequence(Service *service){
+    unsigned char mem[3 * RPC_TABLE_BYTES(2)];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway seqGateway;
+    initRPC(&seqGateway, &arena, 2);
+    Protocol textProto = {
+        .numArgs = 4,
+        .maxCmdLen = 28,
+        .delim = ',',
+        .seqIdx = 2,
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 4 },
+            {.id = "SRVC", .maxSize = 4 },
+            {.id = "SEQ", .maxSize = 6 },
+            {.id = "DATA", .maxSize = 5 }
+        }
+    };
+    Protocol fixedProto = {
+        .numArgs = 3,
+        .mode = PROTO_FIXED,
+        .maxCmdLen = 8,
+        .seqIdx = 2,
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 3 },
+            {.id = "SRVC", .maxSize = 3 },
+            {.id = "SEQ", .maxSize = 2 }
+        }
+    };
+    Interface textInterface = {0};
+    Interface fixedInterface = {0};
+    createInterface(&textInterface, "PIP", &textProto, NULL, &arena, 2);
+    createInterface(&fixedInterface, "PIB", &fixedProto, NULL, &arena, 2);
+    addInterface(&seqGateway, &textInterface);
+    addInterface(&seqGateway, &fixedInterface);
+    registerService(&textInterface, service);
+    registerService(&fixedInterface, service);
+
+    // Test case 1: pipelined commands answer with their own correlation id
+    char first[] = "PIP,TS1,7,A";
+    char second[] = "PIP,TS1,12,B";
+    Command cmds[2] = {0};
+    char txBufs[2][16];
+    Response res[2];
+    Message msg = {.buf = first, .len = uCsize(first)};
+    updateCommand(&cmds[0], &msg, &seqGateway);
+    msg.buf = second;
+    msg.len = uCsize(second);
+    updateCommand(&cmds[1], &msg, &seqGateway);
+    for(int i = 1; i >= 0; i--){
+        initResponse(&res[i], txBufs[i], sizeof(txBufs[i]));
+        execCommand(&cmds[i], &seqGateway, &res[i]); // Answered out of order
+    }
+    Message reply = {.buf = txBufs[1], .len = res[1].len};
+    Message seq, payload;
+    if (uStrcmp(txBufs[0], "7,TS1OK") == 0 && res[0].len == 7
+        && splitResponse(&textProto, &reply, &seq, &payload) == 0
+        && uCncmp("12", seq.buf, seq.len) == 0 && uCncmp("TS1OK", payload.buf, payload.len) == 0) {
+        printf(GRN "Sequence: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Sequence: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: a command without its correlation id is rejected, parsed or streamed
+    char missing[] = "PIP,TS1,,A";
+    msg.buf = missing;
+    msg.len = uCsize(missing);
+    int ret = updateCommand(&cmds[0], &msg, &seqGateway);
+    Parser parser;
+    initParser(&parser, &seqGateway, '\n');
+    int used;
+    int streamed = feedParser(&parser, &cmds[1], "PIP,TS1\n", 8, &used);
+    if (ret == -1 && cmds[0].reject == REJECT_ARGS && streamed == -1 && cmds[1].reject == REJECT_ARGS) {
+        printf(GRN "Sequence: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Sequence: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: binary responses start with the raw seq field
+    char fixed[] = {'P','I','B', 'T','S','1', 0x34, 0x12};
+    msg.buf = fixed;
+    msg.len = sizeof(fixed);
+    updateCommand(&cmds[0], &msg, &seqGateway);
+    initResponse(&res[0], txBufs[0], sizeof(txBufs[0]));
+    execCommand(&cmds[0], &seqGateway, &res[0]);
+    reply.buf = txBufs[0];
+    reply.len = res[0].len;
+    if (splitResponse(&fixedProto, &reply, &seq, &payload) == 0 && seq.len == 2 && seq.buf[0] == 0x34
+        && seq.buf[1] == 0x12 && uCncmp("TS1OK", payload.buf, payload.len) == 0) {
+        printf(GRN "Sequence: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Sequence: Test case 3 failed\n" RESET);
+    }
+}
+
+
+void test_generated(Service *service){
+    unsigned char mem[2][2 * RPC_TABLE_BYTES(1)];
+    RPCArena arenas[2];
+    Gateway gateways[2];
+    Interface interfaces[2];
+    Protocol genericProto = genProto;
+    genericProto.parse = 0; // Same layout through the generic parser
+    Protocol *protos[2] = {&genProto, &genericProto};
+    for(int g = 0; g < 2; g++){
+        initArena(&arenas[g], mem[g], sizeof(mem[g]));
+        initRPC(&gateways[g], &arenas[g], 1);
+        createInterface(&interfaces[g], "IF1", protos[g], NULL, &arenas[g], 1);
+        addInterface(&gateways[g], &interfaces[g]);
+        registerService(&interfaces[g], service);
+    }
+    char *msgs[] = {
+        "IF1,TS1,12,D", "IF1,TS1,-7,DATA", "IF1,TS1,12", "IF1,TS1,", "IF1,TS1,,DATA", "IF1,TS1,x1,D",
+        "IF1,TS1,12,DATAX", "IF1,TS1,1,D,E", "IF1,TS1,123456,D", "IF1,TSX,1,D", "IF1,TS1,1,D,", "IF1"
+    };
+    const int numMsgs = sizeof(msgs) / sizeof(msgs[0]);
+
+    // Test case 1: the generated parser fills the same Command as the generic one
+    int same = 1;
+    for(int m = 0; m < numMsgs; m++){
+        Command cmds[2] = {0};
+        int rets[2];
+        for(int g = 0; g < 2; g++){
+            Message msg = {.buf = msgs[m], .len = uCsize(msgs[m])};
+            rets[g] = updateCommand(&cmds[g], &msg, &gateways[g]);
+        }
+        same &= rets[0] == rets[1] && cmds[0].valid == cmds[1].valid && cmds[0].reject == cmds[1].reject;
+        for(int i = 0; i < genProto.numArgs; i++){
+            same &= cmds[0].args[i].buf == cmds[1].args[i].buf && cmds[0].args[i].len == cmds[1].args[i].len;
+            same &= cmds[0].argv[i].u == cmds[1].argv[i].u;
+        }
+    }
+    if (same) {
+        printf(GRN "Generated: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Generated: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: the declared layout and decoded values
+    Command cmd = {0};
+    Message msg = {.buf = msgs[1], .len = uCsize(msgs[1])};
+    int ret = updateCommand(&cmd, &msg, &gateways[0]);
+    if (genProto.numArgs == 4 && genProto.parse != 0 && uStrcmp(genProto.cmdFormat[2].id, "VAL") == 0
+        && ret == 0 && cmd.valid && cmd.argv[2].i == -7 && cmd.args[3].len == 4) {
+        printf(GRN "Generated: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Generated: Test case 2 failed\n" RESET);
+    }
+}
+
+
+void test_metrics(Gateway *gateway, Service *service){
+    char valid[] = "IF1,TS1,0,D";
+    char noTarget[] = "XX1,TS1,0,D";
+    char noService[] = "IF1,TSX,0,D";
+    char *msgs[] = {valid, noTarget, noService, valid};
+    Command cmd = {0};
+    resetMetrics(gateway);
+    for(int i = 0; i < 4; i++){
+        Message msg = {.buf = msgs[i], .len = uCsize(msgs[i])};
+        if(updateCommand(&cmd, &msg, gateway) == 0){
+            execCommand(&cmd, gateway, NULL);
+        }
+    }
+
+    // Test case 1: accepted commands and rejections are counted by reason
+    GatewayStats gw;
+    snapshotGatewayStats(gateway, &gw);
+    if (gw.accepted == 2 && gw.rejects[REJECT_TARGET] == 1 && gw.rejects[REJECT_SERVICE] == 1
+        && gw.rejects[REJECT_ARGS] == 0 && cmd.reject == REJECT_NONE) {
+        printf(GRN "Metrics: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Metrics: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: every call lands in the latency histogram
+    ServiceStats st;
+    snapshotServiceStats(service, &st);
+    unsigned long total = 0;
+    for(int i = 0; i < RPC_HIST_BUCKETS; i++){
+        total += st.hist[i];
+    }
+    if (st.calls == 2 && total == 2 && st.hist[1] == 2 && st.totalTicks == 2 && st.maxTicks == 1) {
+        printf(GRN "Metrics: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Metrics: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: the built in service reports the counters
+    char txBuf[100];
+    Response res;
+    initResponse(&res, txBuf, sizeof(txBuf));
+    Command report = {0};
+    int ret = metricsService(&report, &res, gateway);
+    if (ret == 0 && uStrcmp(txBuf, "acc=2 rej=1,0,0,1 IF1:2:24 TS1:2:1:1 TS2:0:0:0") == 0) {
+        printf(GRN "Metrics: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Metrics: Test case 3 failed\n" RESET);
+    }
+}
+
+
+static int cacheCalls = 0;
+
+int cached_service(Command *cmd, Response *response, void *data){
+    cacheCalls++;
+    writeResponse(response, cmd->args[2].buf, cmd->args[2].len);
+    return 7;
+}
+
+int write_service(Command *cmd, Response *response, void *data){
+    putResponse(response, "W");
+    return 0;
+}
+
+int pending_write_service(Command *cmd, Response *response, void *data){
+    return deferService(cmd, 0, 0); // The write lands when completeDeferred is called
+}
+
+static int run_cached(Gateway *gateway, char *buf, char *txBuf, int size){
+    // Parse and execute a message, returns the service's return value
+    Message msg = {.buf = buf, .len = uCsize(buf)};
+    Command cmd = {0};
+    Response res;
+    initResponse(&res, txBuf, size);
+    if(updateCommand(&cmd, &msg, gateway) != 0) return -1;
+    execCommand(&cmd, gateway, &res);
+    return getCommandRet(&cmd);
+}
+
+void test_cache(Protocol *proto){
+    static unsigned char mem[RPC_TABLE_BYTES(1) + RPC_TABLE_BYTES(3) + 4 * sizeof(CacheEntry) + sizeof(Deferred) + 2 * RPC_ARENA_ALIGN];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway gateway;
+    initRPC(&gateway, &arena, 1);
+    int ok = initCache(&gateway, &arena, 4) == 0 && initDeferred(&gateway, &arena, 1, 0, 0) == 0;
+    Interface interface = {0};
+    createInterface(&interface, "CCH", proto, NULL, &arena, 3);
+    addInterface(&gateway, &interface);
+    Service get = {.id = "GET", .func = &cached_service, .idempotent = 1, .ttl = 100};
+    Service set = {.id = "SET", .func = &write_service};
+    registerService(&interface, &get);
+    Service pend = {.id = "PND", .func = &pending_write_service};
+    registerService(&interface, &set);
+    registerService(&interface, &pend);
+    char tx1[16], tx2[16];
+
+    // Test case 1: a repeated command is served from the cache, other arguments miss
+    ok &= run_cached(&gateway, "CCH,GET,1,A", tx1, sizeof(tx1)) == 7;
+    ok &= run_cached(&gateway, "CCH,GET,1,A", tx2, sizeof(tx2)) == 7;
+    ok &= uStrcmp(tx1, "1") == 0 && uStrcmp(tx2, "1") == 0 && cacheCalls == 1;
+    ok &= run_cached(&gateway, "CCH,GET,2,A", tx1, sizeof(tx1)) == 7 && uStrcmp(tx1, "2") == 0 && cacheCalls == 2;
+    if (ok && gateway.cacheStats.hits == 1 && gateway.cacheStats.misses == 2) {
+        printf(GRN "Cache: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Cache: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: a non idempotent service or touchInterface invalidates the interface's responses
+    run_cached(&gateway, "CCH,SET,0,A", tx1, sizeof(tx1));
+    run_cached(&gateway, "CCH,GET,1,A", tx1, sizeof(tx1));
+    ok = cacheCalls == 3;
+    touchInterface(&interface);
+    run_cached(&gateway, "CCH,GET,1,A", tx1, sizeof(tx1));
+    if (ok && cacheCalls == 4 && uStrcmp(tx1, "1") == 0) {
+        printf(GRN "Cache: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Cache: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: a response older than the service's ttl runs the service again
+    testTicks += get.ttl;
+    run_cached(&gateway, "CCH,GET,1,A", tx1, sizeof(tx1));
+    ok = cacheCalls == 5;
+    run_cached(&gateway, "CCH,GET,1,A", tx1, sizeof(tx1));
+    if (ok && cacheCalls == 5 && uStrcmp(tx1, "1") == 0) {
+        printf(GRN "Cache: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Cache: Test case 3 failed\n" RESET);
+    }
+
+    // Test case 4: a write run through invokeService, as executor workers do, also drops cached responses
+    char buf[] = "CCH,SET,0,A";
+    Message msg = {.buf = buf, .len = uCsize(buf)};
+    Command cmd = {0};
+    Response res;
+    initResponse(&res, tx2, sizeof(tx2));
+    ok = updateCommand(&cmd, &msg, &gateway) == 0 && invokeService(&cmd, &res) == 0;
+    run_cached(&gateway, "CCH,GET,1,A", tx1, sizeof(tx1));
+    if (ok && cacheCalls == 6 && uStrcmp(tx1, "1") == 0) {
+        printf(GRN "Cache: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "Cache: Test case 4 failed\n" RESET);
+    }
+
+    // Test case 5: a deferred write drops the responses cached while it was pending once it completes
+    run_cached(&gateway, "CCH,PND,0,A", tx1, sizeof(tx1));
+    run_cached(&gateway, "CCH,GET,1,A", tx1, sizeof(tx1)); // Cached while the write is pending
+    run_cached(&gateway, "CCH,GET,1,A", tx1, sizeof(tx1));
+    ok = cacheCalls == 7 && gateway.pending == 1;
+    completeDeferred(&gateway.deferred[0], 0);
+    ok &= pollDeferred(&gateway) == 0;
+    run_cached(&gateway, "CCH,GET,1,A", tx1, sizeof(tx1));
+    if (ok && cacheCalls == 8 && uStrcmp(tx1, "1") == 0) {
+        printf(GRN "Cache: Test case 5 passed\n" RESET);
+    } else {
+        printf(RED "Cache: Test case 5 failed\n" RESET);
+    }
+}
+
+
+static int adcSteps = 0;
+
+int step_adc(Deferred *deferred, Response *response, void *state){
+    // Conversion takes two polls, then answers with the requested channel
+    int *steps = state;
+    if(++(*steps) < 2) return RPC_PENDING;
+    putResponse(response, "ADC");
+    writeResponse(response, deferred->cmd.args[2].buf, deferred->cmd.args[2].len);
+    return 5;
+}
+
+int adc_service(Command *cmd, Response *response, void *data){
+    adcSteps = 0;
+    return deferService(cmd, &step_adc, &adcSteps);
+}
+
+int ext_service(Command *cmd, Response *response, void *data){
+    return deferService(cmd, 0, 0); // Completed from outside, e.g. an interrupt
+}
+
+static char doneBuf[16];
+static int doneRet = 0;
+
+void on_done(Deferred *deferred, void *ctx){
+    int *delivered = ctx;
+    (*delivered)++;
+    uCcpy(doneBuf, deferred->response.buf);
+    doneRet = getCommandRet(&deferred->cmd);
+}
+
+void test_deferred(Protocol *proto, Service *syncService){
+    static unsigned char mem[RPC_TABLE_BYTES(1) + RPC_TABLE_BYTES(3) + sizeof(Deferred) + RPC_ARENA_ALIGN];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway gateway;
+    int delivered = 0;
+    initRPC(&gateway, &arena, 1);
+    int ok = initDeferred(&gateway, &arena, 1, &on_done, &delivered) == 0;
+    Interface interface = {0};
+    createInterface(&interface, "ASY", proto, NULL, &arena, 3);
+    addInterface(&gateway, &interface);
+    Service adc = {.id = "ADC", .func = &adc_service};
+    Service ext = {.id = "EXT", .func = &ext_service};
+    Service sync = *syncService;
+    registerService(&interface, &adc);
+    registerService(&interface, &ext);
+    registerService(&interface, &sync);
+    char buf[20];
+    char txBuf[16];
+    Message msg = {.buf = buf};
+    Command cmd = {0};
+    Response res;
+
+    // Test case 1: a pending service leaves the sink empty and the gateway serves other commands
+    uCcpy(buf, "ASY,ADC,7,A");
+    msg.len = uCsize(buf);
+    initResponse(&res, txBuf, sizeof(txBuf));
+    ok &= updateCommand(&cmd, &msg, &gateway) == 0 && execCommand(&cmd, &gateway, &res) == RPC_PENDING;
+    ok &= res.len == 0 && cmd.deferred != 0 && gateway.pending == 1;
+    Deferred *handle = cmd.deferred;
+    uCcpy(buf, "ASY,TS1,0,D"); // The caller reuses its message buffer
+    msg.len = uCsize(buf);
+    initResponse(&res, txBuf, sizeof(txBuf));
+    ok &= updateCommand(&cmd, &msg, &gateway) == 0 && execCommand(&cmd, &gateway, &res) == 0;
+    char arg[5];
+    if (ok && uStrcmp(txBuf, "TS1OK") == 0 && extractArg(arg, &handle->cmd, "PRAM") == 2 && uStrcmp(arg, "7") == 0) {
+        printf(GRN "Deferred: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Deferred: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: polling steps the service until its response and result are delivered
+    ok = pollDeferred(&gateway) == 1 && delivered == 0;
+    ok &= pollDeferred(&gateway) == 0 && delivered == 1;
+    if (ok && uStrcmp(doneBuf, "ADC7") == 0 && doneRet == 5 && adc.ret == 5) {
+        printf(GRN "Deferred: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Deferred: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: a full pool refuses a pending command, an external completion is delivered
+    uCcpy(buf, "ASY,EXT,1,B");
+    msg.len = uCsize(buf);
+    ok = updateCommand(&cmd, &msg, &gateway) == 0 && execCommand(&cmd, &gateway, NULL) == RPC_PENDING;
+    handle = cmd.deferred;
+    ok &= execCommand(&cmd, &gateway, NULL) == -1 && pollDeferred(&gateway) == 1 && delivered == 1;
+    if(handle != 0){
+        putResponse(&handle->response, "DONE");
+        completeDeferred(handle, 9);
+    }
+    if (ok && handle != 0 && pollDeferred(&gateway) == 0 && delivered == 2 && uStrcmp(doneBuf, "DONE") == 0 && ext.ret == 9) {
+        printf(GRN "Deferred: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Deferred: Test case 3 failed\n" RESET);
+    }
+}
+
+
+static void put_ring(char *ring, int size, int start, char *frame){
+    // Write a frame into a ring buffer from index start, wrapping at the end
+    for(int i = 0; frame[i] != '\0'; i++){
+        ring[(start + i) % size] = frame[i];
+    }
+}
+
+void test_ring(Gateway *gateway){
+    char ring[16];
+    char spill[5];
+    char arg[5];
+    Command cmd = {0};
+
+    // Test case 1: only the argument straddling the wrap point is copied, the others point into the ring
+    put_ring(ring, sizeof(ring), 10, "IF1,TS1,1234,AB");
+    RingView view = ringView(ring, sizeof(ring), 10, 15);
+    int ok = updateCommandRing(&cmd, &view, gateway, spill, sizeof(spill)) == 0;
+    ok &= cmd.args[SERVICE_IDX].buf == spill && cmd.args[2].buf == &ring[2] && cmd.args[3].buf == &ring[7];
+    ok &= extractArg(arg, &cmd, "PRAM") == 2 && uStrcmp(arg, "1234") == 0 && extractArg(arg, &cmd, "DATA") == 3;
+    if (ok && uStrcmp(arg, "AB") == 0 && cmd.service != 0 && uStrcmp(cmd.service->id, "TS1") == 0) {
+        printf(GRN "Ring: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Ring: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: a wrap on a delimiter or no wrap at all needs no spill buffer
+    put_ring(ring, sizeof(ring), 8, "IF1,TS2,,DATA");
+    view = ringView(ring, sizeof(ring), 8, 13);
+    ok = updateCommandRing(&cmd, &view, gateway, 0, 0) == 0 && view.second.len == 5 && cmd.args[2].len == 0;
+    put_ring(ring, sizeof(ring), 0, "IF1,TS1,0,D");
+    view = ringView(ring, sizeof(ring), 0, 11);
+    ok &= updateCommandRing(&cmd, &view, gateway, 0, 0) == 0 && view.second.len == 0;
+    if (ok && extractArg(arg, &cmd, "DATA") == 3 && uStrcmp(arg, "D") == 0) {
+        printf(GRN "Ring: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Ring: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: a straddling target is spilled too, a spill buffer too small or extra arguments are rejected
+    put_ring(ring, sizeof(ring), 14, "IF1,TS1,1,2");
+    view = ringView(ring, sizeof(ring), 14, 11);
+    ok = updateCommandRing(&cmd, &view, gateway, spill, sizeof(spill)) == 0 && cmd.args[TARGET_IDX].buf == spill;
+    put_ring(ring, sizeof(ring), 10, "IF1,TS1,1234,AB");
+    view = ringView(ring, sizeof(ring), 10, 15);
+    ok &= updateCommandRing(&cmd, &view, gateway, spill, 2) == -1 && cmd.reject == REJECT_ARGS;
+    put_ring(ring, sizeof(ring), 12, "IF1,TS1,1,2,3");
+    view = ringView(ring, sizeof(ring), 12, 13);
+    if (ok && updateCommandRing(&cmd, &view, gateway, spill, sizeof(spill)) == -1 && cmd.reject == REJECT_ARGS) {
+        printf(GRN "Ring: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Ring: Test case 3 failed\n" RESET);
+    }
+}
+
+
+int cast_service(Command *cmd, Response *response, void *data){
+    putResponse(response, (char *)data);
+    return 1;
+}
+
+static int run_cast(Gateway *gateway, char *buf, char *txBuf, int size){
+    // Parse and execute a message, returns -1 if it was rejected
+    Message msg = {.buf = buf, .len = uCsize(buf)};
+    Command cmd = {0};
+    Response res;
+    initResponse(&res, txBuf, size);
+    if(updateCommand(&cmd, &msg, gateway) != 0) return -1;
+    return execCommand(&cmd, gateway, &res);
+}
+
+void test_multicast(Protocol *proto){
+    static unsigned char mem[RPC_TABLE_BYTES(5) + 5 * RPC_TABLE_BYTES(2) + sizeof(Deferred) + RPC_ARENA_ALIGN];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway gateway;
+    initRPC(&gateway, &arena, 5);
+    Protocol other = *proto; // Same layout, another protocol
+    Interface interfaces[4] = {0};
+    char *ids[4] = {"SA1", "SA2", "SB1", "SA3"};
+    char *data[4] = {"a", "b", "c", "d"};
+    Service syn[4];
+    for(int i = 0; i < 4; i++){
+        createInterface(&interfaces[i], ids[i], (i < 3) ? proto : &other, data[i], &arena, 2);
+        addInterface(&gateway, &interfaces[i]);
+        syn[i] = (Service){.id = "SYN", .func = &cast_service};
+        registerService(&interfaces[i], &syn[i]);
+    }
+    Service one = {.id = "ONE", .func = &cast_service};
+    registerService(&interfaces[2], &one);
+    char tx[32];
+
+    // Test case 1: a wildcard target is parsed once and runs on every matching interface of its protocol
+    int ok = run_cast(&gateway, "SA*,SYN,1,X", tx, sizeof(tx)) == 0 && uStrcmp(tx, "SA1,a;SA2,b;") == 0;
+    ok &= syn[0].ret == 1 && syn[1].ret == 1 && syn[2].ret == 0 && syn[3].ret == 0;
+    if (ok && run_cast(&gateway, "***,SYN,,X", tx, sizeof(tx)) == 0 && uStrcmp(tx, "SA1,a;SA2,b;SB1,c;") == 0) {
+        printf(GRN "Multicast: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Multicast: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: a group target runs on its members, group ids must be free target ids
+    ok = addGroup(&gateway, "GRP") == 0 && addGroup(&gateway, "GRP") == -1 && addGroup(&gateway, "SA1") == -1;
+    ok &= addGroup(&gateway, "GROUP") == -1 && joinGroup(&gateway, &interfaces[0], "GRP") == 0;
+    ok &= joinGroup(&gateway, &interfaces[2], "GRP") == 0 && joinGroup(&gateway, &interfaces[1], "NOG") == -1;
+    if (ok && run_cast(&gateway, "GRP,SYN,,X", tx, sizeof(tx)) == 0 && uStrcmp(tx, "SA1,a;SB1,c;") == 0) {
+        printf(GRN "Multicast: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Multicast: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: members without the service are skipped, a target matching nothing is rejected
+    ok = run_cast(&gateway, "***,ONE,,X", tx, sizeof(tx)) == 0 && uStrcmp(tx, "SB1,c;") == 0;
+    ok &= run_cast(&gateway, "***,TWO,,X", tx, sizeof(tx)) == -1;
+    if (ok && run_cast(&gateway, "Z**,SYN,,X", tx, sizeof(tx)) == -1 && run_cast(&gateway, "SA1,SYN,,X", tx, sizeof(tx)) == 0
+        && uStrcmp(tx, "a") == 0) {
+        printf(GRN "Multicast: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Multicast: Test case 3 failed\n" RESET);
+    }
+
+    // Test case 4: the stream parser falls back to the first member offering the service like updateCommand
+    Parser parser;
+    Command cmd = {0};
+    Response res;
+    int used;
+    initParser(&parser, &gateway, '\n');
+    initResponse(&res, tx, sizeof(tx));
+    ok = feedParser(&parser, &cmd, "***,ONE,,X\n", 11, &used) == 1 && cmd.interface == &interfaces[2];
+    ok &= execCommand(&cmd, &gateway, &res) == 0 && uStrcmp(tx, "SB1,c;") == 0;
+    if (ok && feedParser(&parser, &cmd, "***,TWO,,X\n", 11, &used) == -1 && cmd.reject == REJECT_SERVICE) {
+        printf(GRN "Multicast: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "Multicast: Test case 4 failed\n" RESET);
+    }
+
+    // Test case 5: an interface cannot take the id of a group, as a group cannot take an interface's
+    Interface taken = {0};
+    createInterface(&taken, "GRP", proto, 0, &arena, 2);
+    if (addInterface(&gateway, &taken) == -1 && gateway.count == 4 && run_cast(&gateway, "GRP,SYN,,X", tx, sizeof(tx)) == 0
+        && uStrcmp(tx, "SA1,a;SB1,c;") == 0) {
+        printf(GRN "Multicast: Test case 5 passed\n" RESET);
+    } else {
+        printf(RED "Multicast: Test case 5 failed\n" RESET);
+    }
+
+    // Test case 6: a member that defers is parked on its own and delivered later, without a handle it fails
+    int delivered = 0;
+    Service def = {.id = "DEF", .func = &ext_service};
+    Service now = {.id = "DEF", .func = &cast_service};
+    ok = initDeferred(&gateway, &arena, 1, &on_done, &delivered) == 0;
+    ok &= registerService(&interfaces[0], &def) == 0 && registerService(&interfaces[1], &now) == 0;
+    ok &= run_cast(&gateway, "SA*,DEF,,X", tx, sizeof(tx)) == 0 && uStrcmp(tx, "SA2,b;") == 0;
+    Deferred *handle = &gateway.deferred[0];
+    ok &= gateway.pending == 1 && handle->busy && handle->cmd.cast == CAST_NONE && handle->response.len == 4;
+    ok &= run_cast(&gateway, "SA*,DEF,,X", tx, sizeof(tx)) == 0 && uStrcmp(tx, "SA1,;SA2,b;") == 0 && def.ret == -1;
+    putResponse(&handle->response, "late");
+    completeDeferred(handle, 4);
+    if (ok && pollDeferred(&gateway) == 0 && delivered == 1 && uStrcmp(doneBuf, "SA1,late") == 0 && def.ret == 4) {
+        printf(GRN "Multicast: Test case 6 passed\n" RESET);
+    } else {
+        printf(RED "Multicast: Test case 6 failed\n" RESET);
+    }
+}
+
+
 int main(void){
     // ** // Initialize Gateway // ** //
+    static unsigned char arenaMem[RPC_TABLE_BYTES(5) + RPC_TABLE_BYTES(10)];
+    RPCArena arena;
+    initArena(&arena, arenaMem, sizeof(arenaMem));
     Gateway gateway;
-    initRPC(&gateway);
+    initRPC(&gateway, &arena, 5);
     
     Protocol testproto1 = {
         .numArgs = 4,
         .maxCmdLen = 28,
         .maxArgLen = 5,
         .delim = ',',
-        .cmdFormat = { 
+        .cmdFormat = (CmdArg[]){
             {.id = "TRGT", .maxSize = 5 },
             {.id = "SRVC", .maxSize = 5 },
             {.id = "PRAM", .maxSize = 5 },
@@ -40,30 +1019,43 @@ int main(void){
     };
 
     Interface testInterface1 = {0};
-    createInterface(&testInterface1, "IF1",&testproto1,NULL);
+    createInterface(&testInterface1, "IF1",&testproto1,NULL, &arena, 10);
     addInterface(&gateway, &testInterface1);
     Service testService1 = {
         .id = "TS1",
         .desc = "Test Service 1",
         .func = &test_service1,
-        .response = "\0",
         .ret = 0,
     };
     Service testService2 = {
         .id = "TS2",
         .desc = "Test Service 2",
         .func = &test_service2,
-        .response = "\0",
         .ret = 0,
     };
     registerService(&testInterface1, &testService1);
     registerService(&testInterface1, &testService2);
 
+    // ********** // Lookup Test // ********** //
+    test_lookup(&gateway, &testInterface1, &testService1);
+    test_reentrant(&gateway);
+    test_stream(&gateway);
+    test_binary(&testService1, &testService2);
+    test_typed(&testService1);
+    test_response(&gateway);
+    test_sequence(&testService1);
+    test_generated(&testService1);
+    test_metrics(&gateway, &testService1);
+    test_cache(&testproto1);
+    test_deferred(&testproto1, &testService1);
+    test_ring(&gateway);
+    test_multicast(&testproto1);
+
     // ** // Run Tests // ** //
     // ********** // Gateway Test // ********** //
     Command Cmd = {0};
     Message msg = {0};
-	const int NUM_TEST = 14;
+	#define NUM_TEST 14
 
     char testcmd[NUM_TEST][100] = {
     	"IF1,TS1,0,D", // Test Case 0: Valid Min
@@ -94,37 +1086,35 @@ int main(void){
 			continue;
 		}
 		// Execute the command and get the response
-		if(execCommand(&Cmd, &gateway) == -1){
+		char response[100] = {0};
+		Response res;
+		initResponse(&res, response, sizeof(response));
+		if(execCommand(&Cmd, &gateway, &res) == -1){
 			printf(RED "Test Case %d: Invalid Command: %s\n" RESET, i, testcmd[i]);
 			clearCommand(&Cmd);
 			continue;
 		}
-		char response[100] = {0};
-		getServiceResponse(
-			getInterface(&gateway, Cmd.proto->cmdFormat[0].str.buf), 
-			Cmd.proto->cmdFormat[1].str.buf,response);
+        char cmdArgs[Cmd.proto->numArgs][Cmd.proto->maxArgLen];
+        for(int i = 0; i < Cmd.proto->numArgs; i++){
+        extractArg(cmdArgs[i], &Cmd,Cmd.proto->cmdFormat[i].id);
+        }
+
 
 		printf("Response: %s\n",response);
-		printf("Return: %d\n",getServiceRet(
-			getInterface(&gateway, Cmd.proto->cmdFormat[0].str.buf), 
-			Cmd.proto->cmdFormat[1].str.buf));
+		printf("Return: %d\n",getCommandRet(&Cmd));
 
 		printf(GRN "Test Case %d: Valid Command: %s\n" RESET, i, testcmd[i]);
 		
         /*
         char target[Cmd.proto->cmdFormat[0].maxSize];
-		extractArg(target, Cmd.proto, "TRGT");
+		extractArg(target, &Cmd, "TRGT");
 		char serviceID[Cmd.proto->cmdFormat[1].maxSize];
-		extractArg(serviceID, Cmd.proto, "SRVC");
+		extractArg(serviceID, &Cmd, "SRVC");
 		char param[Cmd.proto->cmdFormat[2].maxSize];
-		extractArg(param, Cmd.proto, "PRAM");
+		extractArg(param, &Cmd, "PRAM");
 		char data[Cmd.proto->cmdFormat[3].maxSize];
-		extractArg(data, Cmd.proto, "DATA");
+		extractArg(data, &Cmd, "DATA");
         */
-        char cmdArgs[Cmd.proto->numArgs][Cmd.proto->maxArgLen];
-        for(int i = 0; i < Cmd.proto->numArgs; i++){
-        extractArg(cmdArgs[i], Cmd.proto,Cmd.proto->cmdFormat[i].id);
-        }
 
 		printf("| %-10s | %-10s | %-10s | %-10s |\n", "Target", "Service ID", "Param", "Data");
 		printf("|------------|------------|------------|------------|\n");
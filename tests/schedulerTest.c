@@ -0,0 +1,156 @@
+#include <stdio.h>
+
+// Fake clock the test advances by hand
+static unsigned long now = 1000;
+#define RPC_NOW() (now)
+#define SCHED_CAPACITY 4
+#include "../src/microRPCScheduler.h"
+
+// Color codes for printing
+#define RED   "\x1B[31m"
+#define GRN   "\x1B[32m"
+#define RESET "\x1B[0m"
+
+
+// *** SCHEDULER TESTS *** //
+int echo_service(Command *cmd, Response *response, void *data){
+    writeResponse(response, cmd->args[3].buf, cmd->args[3].len);
+    return 0;
+}
+
+static int submit(Scheduler *sched, Gateway *gateway, char *text){
+    // Parse a message into a scratch buffer that is overwritten right after queueing
+    char buf[32];
+    uCcpy(buf, text);
+    Message msg = {.buf = buf, .len = uCsize(buf)};
+    Command cmd = {0};
+    if(updateCommand(&cmd, &msg, gateway) != 0) return -1;
+    int ret = scheduleCommand(sched, &cmd);
+    uCcpy(buf, "XXXXXXXXXXXXXXXXXXX");
+    return ret;
+}
+
+static int run_order(Scheduler *sched, char *order, int size){
+    // Run every queued command, appending each response to order
+    char tx[8];
+    Response res;
+    int len = 0;
+    initResponse(&res, tx, sizeof(tx));
+    while(runNext(sched, &res) != 0 && len + res.len < size){
+        for(int i = 0; i < res.len; i++){
+            order[len++] = tx[i];
+        }
+        initResponse(&res, tx, sizeof(tx));
+    }
+    order[len] = '\0';
+    return len;
+}
+
+int main(void){
+    unsigned char mem[RPC_TABLE_BYTES(1) + RPC_TABLE_BYTES(3) + RPC_TABLE_BYTES(1)];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway gateway;
+    initRPC(&gateway, &arena, 1);
+    Protocol proto = {
+        .numArgs = 4,
+        .maxCmdLen = 28,
+        .delim = ',',
+        .priorityIdx = 2,
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 5 },
+            {.id = "SRVC", .maxSize = 5 },
+            {.id = "PRIO", .maxSize = 3, .type = ARG_INT },
+            {.id = "DATA", .maxSize = 5 }
+        }
+    };
+    Interface interface = {0};
+    createInterface(&interface, "IF1", &proto, NULL, &arena, 3);
+    addInterface(&gateway, &interface);
+    Service bulk = {.id = "BLK", .func = &echo_service, .priority = 0};
+    Service ctrl = {.id = "CTL", .func = &echo_service, .priority = 5};
+    Service timed = {.id = "TMD", .func = &echo_service, .deadline = 100};
+    registerService(&interface, &bulk);
+    registerService(&interface, &ctrl);
+    registerService(&interface, &timed);
+    static Scheduler sched;
+    initScheduler(&sched, &gateway);
+    char order[32];
+
+    // Test case 1: the highest priority runs first, equal priorities in arrival order, a field overrides the service
+    submit(&sched, &gateway, "IF1,BLK,,a");
+    submit(&sched, &gateway, "IF1,BLK,,b");
+    submit(&sched, &gateway, "IF1,CTL,,c");
+    submit(&sched, &gateway, "IF1,BLK,9,d");
+    run_order(&sched, order, sizeof(order));
+    if (uStrcmp(order, "dcab") == 0 && sched.count == 0) {
+        printf(GRN "Scheduler: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Scheduler: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: within a priority the earliest deadline runs first, no deadline last
+    submit(&sched, &gateway, "IF1,BLK,,a");
+    submit(&sched, &gateway, "IF1,TMD,,b");
+    now += 50;
+    submit(&sched, &gateway, "IF1,TMD,,c");
+    run_order(&sched, order, sizeof(order));
+    if (uStrcmp(order, "bca") == 0) {
+        printf(GRN "Scheduler: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Scheduler: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: expired commands are dropped, a full scheduler refuses more
+    submit(&sched, &gateway, "IF1,TMD,,a");
+    submit(&sched, &gateway, "IF1,BLK,,b");
+    submit(&sched, &gateway, "IF1,BLK,,c");
+    submit(&sched, &gateway, "IF1,BLK,,d");
+    int refused = submit(&sched, &gateway, "IF1,CTL,,e") == -1 && sched.refused == 1;
+    now += 101;
+    run_order(&sched, order, sizeof(order));
+    if (refused && uStrcmp(order, "bcd") == 0 && sched.expired == 1 && runNext(&sched, NULL) == 0) {
+        printf(GRN "Scheduler: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Scheduler: Test case 3 failed\n" RESET);
+    }
+
+    // Test case 4: a command parsed across the wrap of a ring, its service id spilled, is queued intact
+    char ring[16];
+    static char spill[5]; // Far from the ring, no span covers both
+    char *frame = "IF1,BLK,,wrap";
+    for(int i = 0; frame[i] != '\0'; i++){
+        ring[(10 + i) % sizeof(ring)] = frame[i];
+    }
+    RingView view = ringView(ring, sizeof(ring), 10, uCsize(frame) - 1);
+    Command cmd = {0};
+    int ok = updateCommandRing(&cmd, &view, &gateway, spill, sizeof(spill)) == 0 && scheduleCommand(&sched, &cmd) == 0;
+    for(int i = 0; i < (int)sizeof(ring); i++){
+        ring[i] = 'X'; // The ring and spill buffer are reused right away
+    }
+    spill[0] = 'X';
+    run_order(&sched, order, sizeof(order));
+    if (ok && uStrcmp(order, "wrap") == 0) {
+        printf(GRN "Scheduler: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "Scheduler: Test case 4 failed\n" RESET);
+    }
+
+    // Test case 5: priority and deadline fields must be numeric arguments after the service id
+    Interface checked = {0};
+    Protocol bad = proto;
+    bad.priorityIdx = MAX_ARGS;
+    ok = createInterface(&checked, "IF2", &bad, NULL, &arena, 1) == -1;
+    bad.priorityIdx = 3; // DATA, a string
+    ok &= createInterface(&checked, "IF2", &bad, NULL, &arena, 1) == -1;
+    bad.priorityIdx = 0;
+    bad.deadlineIdx = 3;
+    ok &= createInterface(&checked, "IF2", &bad, NULL, &arena, 1) == -1;
+    bad.deadlineIdx = 2; // PRIO, an ARG_INT
+    if (ok && createInterface(&checked, "IF2", &bad, NULL, &arena, 1) == 0) {
+        printf(GRN "Scheduler: Test case 5 passed\n" RESET);
+    } else {
+        printf(RED "Scheduler: Test case 5 failed\n" RESET);
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include "../src/microRPCServer.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+// Color codes for printing
+#define RED   "\x1B[31m"
+#define GRN   "\x1B[32m"
+#define RESET "\x1B[0m"
+
+
+// *** SERVER TESTS *** //
+#define SOCKET_PATH "serverTest.sock"
+#define MAX_CONNS 2
+
+int echo_service(Command *cmd, Response *response, void *data){
+    writeResponse(response, cmd->args[2].buf, cmd->args[2].len);
+    return 0;
+}
+
+int big_service(Command *cmd, Response *response, void *data){
+    // Larger than any connection's transmit buffer
+    for(int i = 0; i < SERVER_TX_SIZE; i++){
+        writeResponse(response, "x", 1);
+    }
+    return 0;
+}
+
+int mid_service(Command *cmd, Response *response, void *data){
+    // Fits the transmit buffer, but not behind a few queued responses
+    for(int i = 0; i < SERVER_TX_SIZE - 100; i++){
+        writeResponse(response, "m", 1);
+    }
+    return 0;
+}
+
+void *server_main(void *arg){
+    runServer(arg);
+    return 0;
+}
+
+int connect_client(void){
+    struct sockaddr_un addr = {.sun_family = AF_UNIX, .sun_path = SOCKET_PATH};
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int read_frames(int fd, char *buf, int size, int frames){
+    // Read until frames terminators arrived, returns the bytes read or -1 if the server closed
+    int len = 0;
+    while(frames > 0 && len < size - 1){
+        ssize_t n = recv(fd, buf + len, size - 1 - len, 0);
+        if(n <= 0) return -1;
+        for(int i = len; i < len + n; i++){
+            frames -= (buf[i] == '\n');
+        }
+        len += (int)n;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+int main(void){
+    unsigned char mem[RPC_TABLE_BYTES(1) + RPC_TABLE_BYTES(3)];
+    RPCArena arena;
+    initArena(&arena, mem, sizeof(mem));
+    Gateway gateway;
+    initRPC(&gateway, &arena, 1);
+    Protocol proto = {
+        .numArgs = 3,
+        .maxCmdLen = 20,
+        .delim = ',',
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 5 },
+            {.id = "SRVC", .maxSize = 5 },
+            {.id = "DATA", .maxSize = 6 }
+        }
+    };
+    Interface interface = {0};
+    createInterface(&interface, "IF1", &proto, NULL, &arena, 3);
+    addInterface(&gateway, &interface);
+    Service echo = {.id = "ECH", .func = &echo_service};
+    Service big = {.id = "BIG", .func = &big_service};
+    registerService(&interface, &echo);
+    Service mid = {.id = "MID", .func = &mid_service};
+    registerService(&interface, &big);
+    registerService(&interface, &mid);
+
+    static Server server;
+    static Connection conns[MAX_CONNS];
+    pthread_t thread;
+    int ok = initServer(&server, &gateway, conns, MAX_CONNS, '\n') == 0 && listenUnix(&server, SOCKET_PATH) == 0;
+    pthread_create(&thread, 0, &server_main, &server);
+
+    // Test case 1: frames split across writes are answered in order, rejected frames with SERVER_REJECT
+    char buf[128];
+    int a = connect_client();
+    send(a, "IF1,ECH,one\nIF1,E", 17, 0);
+    usleep(10000);
+    send(a, "CH,two\nXX1,ECH,3\n", 17, 0);
+    if (ok && read_frames(a, buf, sizeof(buf), 3) > 0 && uStrcmp(buf, "one\ntwo\nERR\n") == 0 && buf[12] == '\0') {
+        printf(GRN "Server: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Server: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: clients keep their own partial frames, a full pool refuses one more
+    int b = connect_client();
+    send(a, "IF1,ECH,aa", 10, 0);
+    send(b, "IF1,ECH,bb\n", 11, 0);
+    int c = connect_client();
+    send(a, "a\n", 2, 0);
+    char bufB[32];
+    int refused = (c < 0) || read_frames(c, bufB, sizeof(bufB), 1) == -1;
+    if (read_frames(b, bufB, sizeof(bufB), 1) > 0 && uStrcmp(bufB, "bb\n") == 0
+        && read_frames(a, buf, sizeof(buf), 1) > 0 && uStrcmp(buf, "aaa\n") == 0 && refused) {
+        printf(GRN "Server: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Server: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: pipelined frames from a client that reads late are all answered
+    int frames = 200;
+    for(int i = 0; i < frames; i++){
+        send(b, "IF1,ECH,12345\n", 14, 0);
+    }
+    static char many[200 * 6 + 1];
+    int got = read_frames(b, many, sizeof(many), frames);
+
+    // Test case 4: a response larger than the transmit buffer is answered with SERVER_REJECT, not cut off
+    send(b, "IF1,BIG,\n", 9, 0);
+    char reply[16];
+    int replyLen = read_frames(b, reply, sizeof(reply), 1);
+
+    // Test case 5: a response that only fits once the queued responses are sent waits for them, it is not rejected
+    char burst[20 * 14 + 9 + 1];
+    for(int i = 0; i < 20; i++){
+        uCcpy(burst + 14 * i, "IF1,ECH,12345\n");
+    }
+    uCcpy(burst + 20 * 14, "IF1,MID,\n");
+    send(b, burst, sizeof(burst) - 1, 0);
+    static char midReply[20 * 6 + SERVER_TX_SIZE];
+    int midLen = read_frames(b, midReply, sizeof(midReply), 21);
+    int midOk = midLen == 20 * 6 + SERVER_TX_SIZE - 100 + 1;
+    for(int i = 20 * 6; midOk && i < midLen - 1; i++){
+        midOk = midReply[i] == 'm';
+    }
+    close(a);
+    close(b);
+    if (c >= 0) close(c);
+    usleep(10000);
+    stopServer(&server);
+    pthread_join(thread, 0);
+    if (got == frames * 6 && server.commands == (unsigned long)(5 + frames + 21) && server.rejected == 1 && server.active == 0) {
+        printf(GRN "Server: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Server: Test case 3 failed\n" RESET);
+    }
+    if (replyLen == 4 && uStrcmp(reply, SERVER_REJECT "\n") == 0 && server.overflows == 1) {
+        printf(GRN "Server: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "Server: Test case 4 failed\n" RESET);
+    }
+    if (midOk && server.overflows == 1) {
+        printf(GRN "Server: Test case 5 passed\n" RESET);
+    } else {
+        printf(RED "Server: Test case 5 failed\n" RESET);
+    }
+    closeServer(&server);
+    unlink(SOCKET_PATH);
+    return 0;
+}
@@ -0,0 +1,149 @@
+#define SHARD_ROUTE_SLOTS 4 // Room for 3 interfaces
+#define MICRORPC_MULTICAST
+#include "../src/microRPCShard.h"
+
+#include <stdio.h>
+
+// Color codes for printing
+#define RED   "\x1B[31m"
+#define GRN   "\x1B[32m"
+#define RESET "\x1B[0m"
+
+
+// *** SHARD TESTS *** //
+#define NUM_MESSAGES 20000
+
+typedef struct Counter{
+    unsigned long calls; // Only written by the owning shard
+    long sum;
+    int wrongThread;
+}Counter;
+
+static Counter counters[2];
+static ShardSet set;
+
+int count_service(Command *cmd, Response *response, void *data){
+    Counter *counter = data;
+    counter->calls++;
+    counter->sum += cmd->argv[2].i;
+    putResponse(response, "OK");
+    return 0;
+}
+
+void check_done(Shard *shard, Command *cmd, Response *response, void *ctx){
+    // Runs on the shard thread that owns the command's interface
+    Counter *counter = ctx;
+    if(pthread_equal(pthread_self(), shard->thread) == 0 || cmd->valid == 0 || response->len != 2){
+        counter->wrongThread++;
+    }
+}
+
+int main(void){
+    static unsigned char mem[2][2 * RPC_TABLE_BYTES(1)];
+    static RPCArena arenas[2];
+    static Gateway gateways[2];
+    static Interface interfaces[2];
+    static Service services[2];
+    Protocol proto = {
+        .numArgs = 3,
+        .maxCmdLen = 20,
+        .delim = ',',
+        .cmdFormat = (CmdArg[]){
+            {.id = "TRGT", .maxSize = 5 },
+            {.id = "SRVC", .maxSize = 5 },
+            {.id = "VAL", .maxSize = 6, .type = ARG_INT }
+        }
+    };
+    char *ids[2] = {"IF0", "IF1"};
+    initShards(&set);
+    for(int i = 0; i < 2; i++){
+        // One replica per shard, each holding its own interface
+        initArena(&arenas[i], mem[i], sizeof(mem[i]));
+        initRPC(&gateways[i], &arenas[i], 1);
+        createInterface(&interfaces[i], ids[i], &proto, &counters[i], &arenas[i], 1);
+        addInterface(&gateways[i], &interfaces[i]);
+        uCcpy(services[i].id, "CNT");
+        services[i].func = &count_service;
+        registerService(&interfaces[i], &services[i]);
+        addShard(&set, &gateways[i], i, &check_done, &counters[i]);
+    }
+
+    // Test case 1: an interface routed to two shards and an unknown target are refused
+    if (addShard(&set, &gateways[0], 0, 0, 0) == -1 && set.numShards == 2 && routeMessage(&set, "XX1,CNT,1", 10) == -1
+        && set.unrouted == 1) {
+        printf(GRN "Shard: Test case 1 passed\n" RESET);
+    } else {
+        printf(RED "Shard: Test case 1 failed\n" RESET);
+    }
+
+    // Test case 2: a full ring refuses messages until its shard drains it
+    int queued = 0;
+    while(routeMessage(&set, "IF0,CNT,1", 10) == 0){
+        queued++;
+    }
+    if (queued == SHARD_RING_SIZE && set.shards[0].dropped == 1) {
+        printf(GRN "Shard: Test case 2 passed\n" RESET);
+    } else {
+        printf(RED "Shard: Test case 2 failed\n" RESET);
+    }
+
+    // Test case 3: every message runs once on the shard owning its interface
+    startShards(&set);
+    long expected[2] = {queued, 0};
+    char msg[16];
+    for(int i = 0; i < NUM_MESSAGES; i++){
+        int target = i % 2;
+        int len = snprintf(msg, sizeof(msg), "IF%d,CNT,%d", target, i % 100);
+        while(routeMessage(&set, msg, len + 1) == -1){
+            // Ring is full, the shard catches up
+        }
+        expected[target] += i % 100;
+    }
+    stopShards(&set);
+    unsigned long total = set.shards[0].processed + set.shards[1].processed;
+    if (total == (unsigned long)(queued + NUM_MESSAGES) && counters[0].sum == expected[0] && counters[1].sum == expected[1]
+        && counters[0].calls == set.shards[0].processed && counters[0].wrongThread == 0 && counters[1].wrongThread == 0) {
+        printf(GRN "Shard: Test case 3 passed\n" RESET);
+    } else {
+        printf(RED "Shard: Test case 3 failed\n" RESET);
+    }
+
+    // Test case 4: a shard with an already routed id or too many interfaces is refused without routing any
+    static unsigned char extraMem[2 * RPC_TABLE_BYTES(2) + 4 * RPC_TABLE_BYTES(1)];
+    static RPCArena extraArena;
+    static Gateway extras[2];
+    static Interface extraInterfaces[2][2];
+    char *extraIds[2][2] = {{"IF2", "IF1"}, {"IF2", "IF3"}}; // IF1 is routed, two new ids exceed the table
+    initArena(&extraArena, extraMem, sizeof(extraMem));
+    int ok = 1;
+    for(int g = 0; g < 2; g++){
+        initRPC(&extras[g], &extraArena, 2);
+        for(int i = 0; i < 2; i++){
+            createInterface(&extraInterfaces[g][i], extraIds[g][i], &proto, 0, &extraArena, 1);
+            addInterface(&extras[g], &extraInterfaces[g][i]);
+        }
+        ok &= addShard(&set, &extras[g], -1, 0, 0) == -1;
+    }
+    ok &= routeMessage(&set, "IF2,CNT,1", 10) == -1 && routeMessage(&set, "IF3,CNT,1", 10) == -1;
+    if (ok && set.numShards == 2 && set.numRoutes == 2 && set.unrouted == 3) {
+        printf(GRN "Shard: Test case 4 passed\n" RESET);
+    } else {
+        printf(RED "Shard: Test case 4 failed\n" RESET);
+    }
+
+    // Test case 5: a wildcard target reaches every shard holding a member, or none of them if a ring is full
+    ShardRing *rings[2] = {&set.shards[0].ring, &set.shards[1].ring};
+    ok = routeMessage(&set, "IF*,CNT,1", 10) == 0 && routeMessage(&set, "ZZ*,CNT,1", 10) == -1 && set.unrouted == 4;
+    while(routeMessage(&set, "IF1,CNT,1", 10) == 1){
+        // Fill the second ring, the stopped shards do not drain
+    }
+    unsigned long dropped = set.shards[1].dropped;
+    ok &= routeMessage(&set, "IF*,CNT,1", 10) == -1 && set.shards[1].dropped == dropped + 1;
+    if (ok && atomic_load(&rings[0]->head) - atomic_load(&rings[0]->tail) == 1
+        && atomic_load(&rings[1]->head) - atomic_load(&rings[1]->tail) == SHARD_RING_SIZE) {
+        printf(GRN "Shard: Test case 5 passed\n" RESET);
+    } else {
+        printf(RED "Shard: Test case 5 failed\n" RESET);
+    }
+    return 0;
+}